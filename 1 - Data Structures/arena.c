@@ -0,0 +1,143 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Arena Allocator
+ * Description: Bump allocator with per-size free lists. Used by the Hash Map
+ *              ADT to allocate links and keys without a malloc call each.
+ *****************************************************************************/
+
+#include "arena.h"
+#include <stdlib.h>
+#include <assert.h>
+
+/*** IMPLEMENT ***************************************************************
+ * Rounds a size up to the arena's alignment.
+ * @param size
+ * @return Aligned size.
+ */
+static size_t arenaRound(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Allocates a new block able to hold at least size bytes and links it into the
+ * arena's block list.
+ * @param arena
+ * @param size Usable bytes needed in the block.
+ * @return Start of the block's usable bytes.
+ */
+static char* arenaBlockNew(Arena* arena, size_t size)
+{
+    ArenaBlock* block = malloc(arenaRound(sizeof(ArenaBlock)) + size);
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->blockCount++;
+    arena->bytes += arenaRound(sizeof(ArenaBlock)) + size;
+    return (char*)block + arenaRound(sizeof(ArenaBlock));
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates an empty arena. No memory is requested until the first allocation.
+ * @param blockSize Bytes to request from malloc at a time.
+ * @return The allocated arena.
+ */
+Arena* arenaNew(size_t blockSize)
+{
+    Arena* arena = malloc(sizeof(Arena));
+    arena->blocks = NULL;
+    arena->next = NULL;
+    arena->left = 0;
+    arena->blockSize = blockSize;
+    arena->blockCount = 0;
+    arena->bytes = 0;
+    for (int i = 0; i < ARENA_CLASSES; i++)
+    {
+        arena->freeLists[i] = NULL;
+    }
+    return arena;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees every block of the arena and the arena itself. Everything allocated
+ * from the arena becomes invalid.
+ * @param arena
+ */
+void arenaDelete(Arena* arena)
+{
+    assert(arena != NULL);
+    while (arena->blocks != NULL)
+    {
+        ArenaBlock* garbage = arena->blocks;
+        arena->blocks = garbage->next;
+        free(garbage);
+    }
+    free(arena);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Allocates size bytes aligned to ARENA_ALIGN. A freed object of the same size
+ * class is reused if there is one, otherwise the bytes are bumped off the
+ * newest block. Objects too large to share a block get a block of their own.
+ * @param arena
+ * @param size
+ * @return Pointer to the allocated bytes.
+ */
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    assert(arena != NULL);
+    size = arenaRound(size == 0 ? 1 : size);
+
+    // Reuse a freed object of the same size class
+    size_t sizeClass = size / ARENA_ALIGN - 1;
+    if (sizeClass < ARENA_CLASSES && arena->freeLists[sizeClass] != NULL)
+    {
+        void* ptr = arena->freeLists[sizeClass];
+        arena->freeLists[sizeClass] = *(void**)ptr;
+        return ptr;
+    }
+
+    // Large objects get a dedicated block so they do not waste the current one
+    if (size > arena->blockSize / 4)
+    {
+        return arenaBlockNew(arena, size);
+    }
+
+    // Start a new block when the current one is exhausted
+    if (size > arena->left)
+    {
+        arena->next = arenaBlockNew(arena, arena->blockSize);
+        arena->left = arena->blockSize;
+    }
+    void* ptr = arena->next;
+    arena->next += size;
+    arena->left -= size;
+    return ptr;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns an object to the arena for reuse by a later allocation of the same
+ * size. Objects larger than the biggest size class are only released when the
+ * arena is deleted.
+ * @param arena
+ * @param ptr Object returned by arenaAlloc.
+ * @param size The size ptr was allocated with.
+ */
+void arenaFree(Arena* arena, void* ptr, size_t size)
+{
+    assert(arena != NULL);
+    if (ptr == NULL)
+    {
+        return;
+    }
+    size_t sizeClass = arenaRound(size == 0 ? 1 : size) / ARENA_ALIGN - 1;
+    if (sizeClass < ARENA_CLASSES)
+    {
+        *(void**)ptr = arena->freeLists[sizeClass];
+        arena->freeLists[sizeClass] = ptr;
+    }
+}
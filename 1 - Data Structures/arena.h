@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Arena Allocator
+ * Description: Header file for a bump allocator that carves small objects out
+ *              of large blocks. Freed objects are kept on per-size free lists
+ *              for reuse, and deleting the arena releases every block at once.
+ *****************************************************************************/
+
+#include <stddef.h>
+
+// Default size of each block requested from malloc.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// Allocations are rounded up to a multiple of this many bytes.
+#define ARENA_ALIGN 8
+// Sizes up to ARENA_CLASSES * ARENA_ALIGN bytes are recycled by arenaFree.
+#define ARENA_CLASSES 32
+
+typedef struct Arena Arena;
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock
+{
+    ArenaBlock* next;
+};
+
+struct Arena
+{
+    // Every block owned by the arena, newest first.
+    ArenaBlock* blocks;
+    // Unused bytes at the end of the newest block.
+    char* next;
+    size_t left;
+    size_t blockSize;
+    // Freed objects of each size class, linked through their first bytes.
+    void* freeLists[ARENA_CLASSES];
+    // Number of blocks allocated.
+    int blockCount;
+    // Bytes requested from malloc for the blocks.
+    size_t bytes;
+};
+
+Arena* arenaNew(size_t blockSize);
+void arenaDelete(Arena* arena);
+void* arenaAlloc(Arena* arena, size_t size);
+void arenaFree(Arena* arena, void* ptr, size_t size);
+
+#endif
@@ -0,0 +1,716 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Benchmark Suite
+ * Description: Repeatable measurements of the Hash Map and spell checker hot
+ *              paths, for comparing hash functions, table layouts, distance
+ *              kernels and suggestion engines before and after a change.
+ *              Every case runs warmup repetitions that are thrown away, then
+ *              timed repetitions whose samples are summarized as a mean and
+ *              percentiles, printed as a table, CSV or JSON.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "hashMap.h"
+#include "wordReader.h"
+#include "levenshtein.h"
+#include "suggestion.h"
+#include "bkTree.h"
+#include "dawg.h"
+#include "symSpell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+// Map operations are timed this many at a time, since one lookup takes less
+// time than reading the clock. Each batch gives one sample.
+#define BATCH 1024
+// Misspelled queries the kernels and suggestion engines are timed with.
+#define QUERIES 100
+// Suggestions asked of each engine, as spellChecker does by default.
+#define SUGGESTIONS 5
+
+// Output formats.
+enum { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON };
+
+static int format = FORMAT_TABLE;
+static int repetitions = 5;
+static int warmups = 1;
+// Rows printed so far, so JSON knows where commas go.
+static int rows = 0;
+
+// Keys a map is filled with, and as many keys that are not among them.
+typedef struct KeySet
+{
+    const char* name;
+    char** keys;
+    char** misses;
+    int count;
+} KeySet;
+
+// Hash functions and layouts the map cases cover.
+static const struct
+{
+    const char* name;
+    HashFunction hash;
+} hashes[] = {
+    {"fnv1a", hashFnv1a},
+    {"wy", hashWy},
+};
+static const struct
+{
+    const char* name;
+    HashMapLayout layout;
+} layouts[] = {
+    {"chained", HASH_MAP_CHAINED},
+    {"open", HASH_MAP_OPEN},
+};
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a monotonic timestamp in seconds.
+ * @return Seconds since an arbitrary fixed point.
+ ****************************************************************************/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the next number of a xorshift generator, so every run uses the
+ * same synthetic keys and orders.
+ * @param state Generator state, updated.
+ * @return Pseudo random number.
+ ****************************************************************************/
+static unsigned int nextRandom(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Compares two samples for qsort.
+ * @param a
+ * @param b
+ * @return Negative, zero or positive as a is less than, equal to or greater
+ *         than b.
+ ****************************************************************************/
+static int compareSamples(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints one result row: the mean, median, 90th and 99th percentile and
+ * maximum of a case's samples, in the chosen format.
+ * @param group Section the case belongs to.
+ * @param subject What was measured, such as a layout and hash.
+ * @param keys Key set or query set used.
+ * @param op Operation timed.
+ * @param unit Unit of the samples.
+ * @param samples Sorted in place.
+ * @param count Number of samples.
+ ****************************************************************************/
+static void report(const char* group, const char* subject, const char* keys, const char* op,
+                   const char* unit, double* samples, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    qsort(samples, count, sizeof(double), compareSamples);
+    double mean = 0;
+    for (int i = 0; i < count; i++)
+    {
+        mean += samples[i];
+    }
+    mean /= count;
+    double p50 = samples[count / 2];
+    double p90 = samples[count * 9 / 10];
+    double p99 = samples[count * 99 / 100];
+    double max = samples[count - 1];
+
+    if (format == FORMAT_CSV)
+    {
+        if (rows == 0)
+        {
+            printf("group,subject,keys,op,unit,samples,mean,p50,p90,p99,max\n");
+        }
+        printf("%s,%s,%s,%s,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f\n", group, subject, keys, op, unit,
+               count, mean, p50, p90, p99, max);
+    }
+    else if (format == FORMAT_JSON)
+    {
+        printf("%s\n  {\"group\": \"%s\", \"subject\": \"%s\", \"keys\": \"%s\", \"op\": \"%s\", "
+               "\"unit\": \"%s\", \"samples\": %d, \"mean\": %.2f, \"p50\": %.2f, "
+               "\"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+               rows == 0 ? "[" : ",", group, subject, keys, op, unit, count, mean, p50, p90,
+               p99, max);
+    }
+    else
+    {
+        if (rows == 0)
+        {
+            printf("%-8s %-14s %-11s %-8s %-6s %8s %10s %10s %10s %10s %10s\n", "group",
+                   "subject", "keys", "op", "unit", "samples", "mean", "p50", "p90", "p99",
+                   "max");
+        }
+        printf("%-8s %-14s %-11s %-8s %-6s %8d %10.2f %10.2f %10.2f %10.2f %10.2f\n", group,
+               subject, keys, op, unit, count, mean, p50, p90, p99, max);
+    }
+    rows++;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Makes a key set of count synthetic keys and count keys absent from it.
+ * @param name Label of the set.
+ * @param count
+ * @param kind 0 for random lowercase words, 1 for numbered keys sharing a
+ *             prefix, 2 for long URL-like keys.
+ * @return The key set.
+ ****************************************************************************/
+static KeySet syntheticKeys(const char* name, int count, int kind)
+{
+    KeySet set = {name, malloc(sizeof(char*) * count), malloc(sizeof(char*) * count), count};
+    unsigned int state = 2463534242u;
+    char key[128];
+    for (int i = 0; i < 2 * count; i++)
+    {
+        if (kind == 0)
+        {
+            // Random letters, misses marked with a digit no key contains
+            int length = 4 + nextRandom(&state) % 9;
+            for (int c = 0; c < length; c++)
+            {
+                key[c] = 'a' + nextRandom(&state) % 26;
+            }
+            key[length] = '\0';
+            if (i >= count)
+            {
+                key[0] = '0';
+            }
+        }
+        else if (kind == 1)
+        {
+            sprintf(key, "key%08d", i);
+        }
+        else
+        {
+            sprintf(key, "https://example.com/articles/%08x/%d/index.html",
+                    nextRandom(&state), i);
+        }
+        if (i < count)
+        {
+            set.keys[i] = strdup(key);
+        }
+        else
+        {
+            set.misses[i - count] = strdup(key);
+        }
+    }
+    return set;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Makes a key set of the words in a file. Capitalized copies of the words
+ * serve as misses, since the dictionary is lowercase.
+ * @param path
+ * @return The key set, with count 0 if the file cannot be read.
+ ****************************************************************************/
+static KeySet fileKeys(const char* path)
+{
+    KeySet set = {"dictionary", NULL, NULL, 0};
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return set;
+    }
+    WordReader* reader = wordReaderNew(file);
+    fclose(file);
+    int capacity = 1024;
+    set.keys = malloc(sizeof(char*) * capacity);
+    const char* word;
+    while ((word = wordReaderNext(reader, NULL)) != NULL)
+    {
+        if (set.count == capacity)
+        {
+            capacity *= 2;
+            set.keys = realloc(set.keys, sizeof(char*) * capacity);
+        }
+        set.keys[set.count++] = strdup(word);
+    }
+    wordReaderDelete(reader);
+
+    set.misses = malloc(sizeof(char*) * (set.count + 1));
+    for (int i = 0; i < set.count; i++)
+    {
+        set.misses[i] = strdup(set.keys[i]);
+        set.misses[i][0] = toupper((unsigned char)set.misses[i][0]);
+    }
+    return set;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees a key set.
+ * @param set
+ ****************************************************************************/
+static void keySetDelete(KeySet* set)
+{
+    for (int i = 0; i < set->count; i++)
+    {
+        free(set->keys[i]);
+        free(set->misses[i]);
+    }
+    free(set->keys);
+    free(set->misses);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Times every map operation for one layout and hash function over a key set.
+ * Each repetition inserts every key into an empty map, doubles the table
+ * with hashMapReserve, looks every key and every miss up in random order and
+ * removes every key in random order. Insert, lookup and remove samples are
+ * nanoseconds per operation over a batch; resize samples are nanoseconds per
+ * key moved.
+ * @param set
+ * @param layout Index into layouts.
+ * @param hash Index into hashes.
+ ****************************************************************************/
+static void benchMap(KeySet* set, int layout, int hash)
+{
+    int count = set->count;
+    int batches = (count + BATCH - 1) / BATCH;
+    double* insert = malloc(sizeof(double) * batches * repetitions);
+    double* hit = malloc(sizeof(double) * batches * repetitions);
+    double* miss = malloc(sizeof(double) * batches * repetitions);
+    double* removal = malloc(sizeof(double) * batches * repetitions);
+    double* resize = malloc(sizeof(double) * repetitions);
+    int samples = 0;
+
+    // Visit keys in a fixed random order so lookups do not follow insertion
+    int* order = malloc(sizeof(int) * count);
+    unsigned int state = 88172645u;
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+    for (int i = count - 1; i > 0; i--)
+    {
+        int j = nextRandom(&state) % (i + 1);
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+
+    long found = 0;
+    for (int r = -warmups; r < repetitions; r++)
+    {
+        int timed = r >= 0;
+        HashMap* map = hashMapNewLayout(1000, layouts[layout].layout);
+        hashMapSetHash(map, hashes[hash].hash, 0);
+        hashMapUseArena(map);
+
+        int batch = timed ? r * batches : 0;
+        for (int start = 0; start < count; start += BATCH, batch++)
+        {
+            int end = start + BATCH < count ? start + BATCH : count;
+            double begin = now();
+            for (int i = start; i < end; i++)
+            {
+                hashMapPut(map, set->keys[i], i);
+            }
+            insert[batch] = (now() - begin) * 1e9 / (end - start);
+        }
+
+        double begin = now();
+        hashMapReserve(map, 2 * hashMapCapacity(map));
+        resize[timed ? r : 0] = (now() - begin) * 1e9 / count;
+
+        batch = timed ? r * batches : 0;
+        for (int start = 0; start < count; start += BATCH, batch++)
+        {
+            int end = start + BATCH < count ? start + BATCH : count;
+            begin = now();
+            for (int i = start; i < end; i++)
+            {
+                found += hashMapContainsKey(map, set->keys[order[i]]);
+            }
+            hit[batch] = (now() - begin) * 1e9 / (end - start);
+
+            begin = now();
+            for (int i = start; i < end; i++)
+            {
+                found += hashMapContainsKey(map, set->misses[order[i]]);
+            }
+            miss[batch] = (now() - begin) * 1e9 / (end - start);
+        }
+
+        batch = timed ? r * batches : 0;
+        for (int start = 0; start < count; start += BATCH, batch++)
+        {
+            int end = start + BATCH < count ? start + BATCH : count;
+            begin = now();
+            for (int i = start; i < end; i++)
+            {
+                hashMapRemove(map, set->keys[order[i]]);
+            }
+            removal[batch] = (now() - begin) * 1e9 / (end - start);
+        }
+        hashMapDelete(map);
+        samples = timed ? (r + 1) * batches : 0;
+    }
+    if (found != (long)count * (repetitions + warmups))
+    {
+        fprintf(stderr, "%s %s: lookups found %ld keys\n", layouts[layout].name,
+                hashes[hash].name, found);
+    }
+
+    char subject[32];
+    sprintf(subject, "%s/%s", layouts[layout].name, hashes[hash].name);
+    report("map", subject, set->name, "insert", "ns", insert, samples);
+    report("map", subject, set->name, "hit", "ns", hit, samples);
+    report("map", subject, set->name, "miss", "ns", miss, samples);
+    report("map", subject, set->name, "remove", "ns", removal, samples);
+    report("map", subject, set->name, "resize", "ns/key", resize, repetitions);
+    free(order);
+    free(insert);
+    free(hit);
+    free(miss);
+    free(removal);
+    free(resize);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Makes misspelled queries from dictionary words by deleting, inserting or
+ * replacing one or two letters.
+ * @param set Dictionary.
+ * @param queries Array of QUERIES buffers of 64 bytes to fill.
+ ****************************************************************************/
+static void makeQueries(KeySet* set, char (*queries)[64])
+{
+    unsigned int state = 521288629u;
+    for (int q = 0; q < QUERIES; q++)
+    {
+        char* query = queries[q];
+        snprintf(query, 64, "%s", set->keys[nextRandom(&state) % set->count]);
+        int edits = 1 + nextRandom(&state) % 2;
+        for (int e = 0; e < edits; e++)
+        {
+            int length = strlen(query);
+            int at = nextRandom(&state) % (length + 1);
+            int kind = nextRandom(&state) % 3;
+            char letter = 'a' + nextRandom(&state) % 26;
+            if (kind == 0 && length > 1 && at < length)
+            {
+                memmove(query + at, query + at + 1, length - at);
+            }
+            else if (kind == 1 && length < 62)
+            {
+                memmove(query + at + 1, query + at, length - at + 1);
+                query[at] = letter;
+            }
+            else if (at < length)
+            {
+                query[at] = letter;
+            }
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Edit distance by the textbook dynamic program, one row at a time. The
+ * baseline the bit-parallel kernel is compared against.
+ * @param a
+ * @param b
+ * @return Levenshtein distance between a and b.
+ ****************************************************************************/
+static int distanceDp(const char* a, const char* b)
+{
+    int lengthA = strlen(a);
+    int lengthB = strlen(b);
+    int row[lengthA + 1];
+    for (int i = 0; i <= lengthA; i++)
+    {
+        row[i] = i;
+    }
+    for (int j = 1; j <= lengthB; j++)
+    {
+        int diagonal = row[0];
+        row[0] = j;
+        for (int i = 1; i <= lengthA; i++)
+        {
+            int above = row[i];
+            int cost = diagonal + (a[i - 1] != b[j - 1]);
+            int best = above + 1 < row[i - 1] + 1 ? above + 1 : row[i - 1] + 1;
+            row[i] = cost < best ? cost : best;
+            diagonal = above;
+        }
+    }
+    return row[lengthA];
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Times comparing each query with every dictionary word using each distance
+ * kernel. A sample is the nanoseconds per comparison over one query.
+ * @param set Dictionary.
+ * @param queries
+ ****************************************************************************/
+static void benchKernels(KeySet* set, char (*queries)[64])
+{
+    const char* kernels[] = {"dp", "myers", "myers<=2"};
+    double* samples = malloc(sizeof(double) * QUERIES * repetitions);
+    long checksum = 0;
+    for (int kernel = 0; kernel < 3; kernel++)
+    {
+        int count = 0;
+        for (int r = -warmups; r < repetitions; r++)
+        {
+            for (int q = 0; q < QUERIES; q++)
+            {
+                LevenshteinPattern* pattern = levenshteinPatternNew(queries[q]);
+                double begin = now();
+                for (int i = 0; i < set->count; i++)
+                {
+                    if (kernel == 0)
+                    {
+                        checksum += distanceDp(queries[q], set->keys[i]);
+                    }
+                    else if (kernel == 1)
+                    {
+                        checksum += levenshteinDistance(pattern, set->keys[i]);
+                    }
+                    else
+                    {
+                        checksum += levenshteinDistanceBounded(pattern, set->keys[i], 2);
+                    }
+                }
+                double elapsed = now() - begin;
+                levenshteinPatternDelete(pattern);
+                if (r >= 0)
+                {
+                    samples[count++] = elapsed * 1e9 / set->count;
+                }
+            }
+        }
+        report("kernel", kernels[kernel], "dictionary", "distance", "ns", samples, count);
+    }
+    if (checksum == 0)
+    {
+        fprintf(stderr, "kernels computed no distances\n");
+    }
+    free(samples);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the closest words to a query by comparing it with every word, the
+ * way spellChecker's scan does on one thread.
+ * @param set Dictionary.
+ * @param query
+ * @param results Array of SUGGESTIONS suggestions.
+ * @return Number of suggestions found.
+ ****************************************************************************/
+static int scanQuery(KeySet* set, const char* query, Suggestion* results)
+{
+    LevenshteinPattern* pattern = levenshteinPatternNew(query);
+    int count = 0;
+    int limit = INT_MAX - 1;
+    for (int i = 0; i < set->count; i++)
+    {
+        int distance = levenshteinDistanceBounded(pattern, set->keys[i], limit);
+        if (distance <= limit)
+        {
+            count = suggestionOffer(results, count, SUGGESTIONS, set->keys[i], distance);
+            limit = suggestionLimit(results, count, SUGGESTIONS, limit);
+        }
+    }
+    levenshteinPatternDelete(pattern);
+    suggestionSort(results, count);
+    return count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds each suggestion engine once over the dictionary, then times its
+ * queries. Build samples are milliseconds, query samples microseconds per
+ * query.
+ * @param set Dictionary.
+ * @param queries
+ ****************************************************************************/
+static void benchSuggest(KeySet* set, char (*queries)[64])
+{
+    const char** words = (const char**)set->keys;
+    const char* engines[] = {"scan", "bktree", "dawg", "symspell"};
+    double build[4];
+
+    double begin = now();
+    BkTree* tree = bkTreeNew();
+    for (int i = 0; i < set->count; i++)
+    {
+        bkTreeAdd(tree, words[i]);
+    }
+    build[1] = (now() - begin) * 1e3;
+    begin = now();
+    Dawg* dawg = dawgNew(words, set->count);
+    build[2] = (now() - begin) * 1e3;
+    begin = now();
+    SymSpell* symSpell = symSpellNew(words, set->count, 2, SYM_SPELL_PREFIX);
+    build[3] = (now() - begin) * 1e3;
+
+    double* samples = malloc(sizeof(double) * QUERIES * repetitions);
+    Suggestion results[SUGGESTIONS];
+    for (int engine = 0; engine < 4; engine++)
+    {
+        if (engine > 0)
+        {
+            report("suggest", engines[engine], "dictionary", "build", "ms", &build[engine], 1);
+        }
+        int count = 0;
+        for (int r = -warmups; r < repetitions; r++)
+        {
+            for (int q = 0; q < QUERIES; q++)
+            {
+                const char* query = queries[q];
+                int length = strlen(query);
+                begin = now();
+                if (engine == 0)
+                {
+                    scanQuery(set, query, results);
+                }
+                else if (engine == 1)
+                {
+                    bkTreeQuery(tree, query, SUGGESTIONS, length, results);
+                }
+                else if (engine == 2)
+                {
+                    dawgQuery(dawg, query, SUGGESTIONS, length, results);
+                }
+                else
+                {
+                    symSpellQuery(symSpell, query, SUGGESTIONS, results);
+                }
+                double elapsed = now() - begin;
+                if (r >= 0)
+                {
+                    samples[count++] = elapsed * 1e6;
+                }
+            }
+        }
+        report("suggest", engines[engine], "dictionary", "query", "us", samples, count);
+    }
+    free(samples);
+    bkTreeDelete(tree);
+    dawgDelete(dawg);
+    symSpellDelete(symSpell);
+}
+
+
+/*** MAIN *********************************************************************
+ * Usage: benchSuite [-r repetitions] [-w warmups] [-f table|csv|json]
+ *                   [-s map|kernel|suggest] [dictionary]
+ *   -r  Timed repetitions of every case. Default 5.
+ *   -w  Untimed repetitions run first. Default 1.
+ *   -f  Output format. Default table.
+ *   -s  Run only one section.
+ * The map section runs every layout and hash function over the dictionary
+ * and synthetic random, numbered and long keys of the same count. The
+ * kernel and suggest sections use misspellings of dictionary words.
+ * @param argc
+ * @param argv
+ * @return
+ ****************************************************************************/
+int main(int argc, char** argv)
+{
+    const char* section = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "r:w:f:s:")) != -1)
+    {
+        if (option == 'r')
+        {
+            repetitions = atoi(optarg);
+        }
+        else if (option == 'w')
+        {
+            warmups = atoi(optarg);
+        }
+        else if (option == 'f')
+        {
+            format = strcmp(optarg, "csv") == 0 ? FORMAT_CSV
+                   : strcmp(optarg, "json") == 0 ? FORMAT_JSON
+                   : strcmp(optarg, "table") == 0 ? FORMAT_TABLE : -1;
+        }
+        else if (option == 's')
+        {
+            section = optarg;
+        }
+        else
+        {
+            format = -1;
+        }
+    }
+    KeySet dictionary = fileKeys(optind < argc ? argv[optind] : "dictionary.txt");
+    if (format < 0 || repetitions < 1 || warmups < 0 || dictionary.count == 0)
+    {
+        printf("usage: benchSuite [-r repetitions] [-w warmups] [-f table|csv|json] "
+               "[-s map|kernel|suggest] [dictionary]\n");
+        return 1;
+    }
+
+    if (section == NULL || strcmp(section, "map") == 0)
+    {
+        KeySet sets[4] = {dictionary, syntheticKeys("random", dictionary.count, 0),
+                          syntheticKeys("numbered", dictionary.count, 1),
+                          syntheticKeys("long", dictionary.count, 2)};
+        for (int s = 0; s < 4; s++)
+        {
+            for (int l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++)
+            {
+                for (int h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+                {
+                    benchMap(&sets[s], l, h);
+                }
+            }
+        }
+        for (int s = 1; s < 4; s++)
+        {
+            keySetDelete(&sets[s]);
+        }
+    }
+
+    char queries[QUERIES][64];
+    makeQueries(&dictionary, queries);
+    if (section == NULL || strcmp(section, "kernel") == 0)
+    {
+        benchKernels(&dictionary, queries);
+    }
+    if (section == NULL || strcmp(section, "suggest") == 0)
+    {
+        benchSuggest(&dictionary, queries);
+    }
+    if (format == FORMAT_JSON)
+    {
+        printf("%s\n", rows == 0 ? "[]" : "\n]");
+    }
+    keySetDelete(&dictionary);
+    return 0;
+}
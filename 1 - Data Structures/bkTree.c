@@ -0,0 +1,241 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * BK-Tree
+ * Description: Burkhard-Keller tree of words. A search for words within
+ *              radius r of a query at distance d from a node only needs the
+ *              children whose edge lies in [d - r, d + r].
+ *****************************************************************************/
+
+#include "bkTree.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// Subtree waiting to be searched by bkTreeQuery.
+typedef struct BkPending
+{
+    BkNode* node;
+    // No word below node is closer to the query than this.
+    int bound;
+} BkPending;
+
+/*** IMPLEMENT ***************************************************************
+ * Creates an empty tree.
+ * @return The allocated tree.
+ */
+BkTree* bkTreeNew()
+{
+    BkTree* tree = malloc(sizeof(BkTree));
+    tree->root = NULL;
+    tree->arena = arenaNew(ARENA_BLOCK_SIZE);
+    tree->size = 0;
+    tree->queries = 0;
+    tree->visited = 0;
+    return tree;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the tree and every word in it.
+ * @param tree
+ */
+void bkTreeDelete(BkTree* tree)
+{
+    assert(tree != NULL);
+    arenaDelete(tree->arena);
+    free(tree);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Adds a copy of a word to the tree. Words already in the tree are ignored.
+ * @param tree
+ * @param word
+ */
+void bkTreeAdd(BkTree* tree, const char* word)
+{
+    assert(tree != NULL && word != NULL);
+    size_t length = strlen(word);
+    BkNode* node = arenaAlloc(tree->arena, sizeof(BkNode) + length + 1);
+    node->child = NULL;
+    node->sibling = NULL;
+    memcpy(node->word, word, length + 1);
+
+    if (tree->root == NULL)
+    {
+        node->edge = 0;
+        tree->root = node;
+        tree->size++;
+        return;
+    }
+
+    // Walk down the edges labelled with the word's distance to each node
+    LevenshteinPattern* pattern = levenshteinPatternNew(word);
+    BkNode* parent = tree->root;
+    while (1)
+    {
+        int distance = levenshteinDistance(pattern, parent->word);
+        if (distance == 0)
+        {
+            arenaFree(tree->arena, node, sizeof(BkNode) + length + 1);
+            break;
+        }
+        BkNode* child = parent->child;
+        while (child != NULL && child->edge != distance)
+        {
+            child = child->sibling;
+        }
+        if (child == NULL)
+        {
+            node->edge = distance;
+            node->sibling = parent->child;
+            parent->child = node;
+            tree->size++;
+            break;
+        }
+        parent = child;
+    }
+    levenshteinPatternDelete(pattern);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Pushes a node onto a min-heap ordered by the lowest distance any word in
+ * the node's subtree can have from the query.
+ * @param heap
+ * @param count Number of entries in the heap, updated.
+ * @param capacity Size of the heap array, updated when it grows.
+ * @param node
+ * @param bound Lowest possible distance below node.
+ * @return The heap, moved if it had to grow.
+ */
+static BkPending* heapPush(BkPending* heap, int* count, int* capacity,
+                           BkNode* node, int bound)
+{
+    if (*count == *capacity)
+    {
+        *capacity *= 2;
+        heap = realloc(heap, sizeof(BkPending) * *capacity);
+    }
+    // Sift the new entry up past larger bounds
+    int i = (*count)++;
+    while (i > 0 && heap[(i - 1) / 2].bound > bound)
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].node = node;
+    heap[i].bound = bound;
+    return heap;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Removes the entry with the lowest bound from a min-heap.
+ * @param heap
+ * @param count Number of entries in the heap, updated.
+ * @return The removed entry.
+ */
+static BkPending heapPop(BkPending* heap, int* count)
+{
+    BkPending top = heap[0];
+    BkPending last = heap[--(*count)];
+    // Sift the last entry down from the root
+    int i = 0;
+    while (2 * i + 1 < *count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < *count && heap[child + 1].bound < heap[child].bound)
+        {
+            child++;
+        }
+        if (heap[child].bound >= last.bound)
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the k words closest to a word, ties broken alphabetically. Subtrees
+ * are searched best first: a word below an edge e of a node at distance d
+ * is at least |d - e| from the query, and the search stops once the lowest
+ * such bound is beyond the k-th closest word found.
+ * @param tree
+ * @param word Query.
+ * @param k Maximum number of results.
+ * @param maxDistance Largest distance a result may have.
+ * @param results Array of at least k results, filled closest first.
+ * @return Number of results found.
+ */
+int bkTreeQuery(BkTree* tree, const char* word, int k, int maxDistance,
+                Suggestion* results)
+{
+    assert(tree != NULL && word != NULL && results != NULL);
+    tree->queries++;
+    if (tree->root == NULL || k <= 0)
+    {
+        return 0;
+    }
+
+    LevenshteinPattern* pattern = levenshteinPatternNew(word);
+    int count = 0;
+    int radius = maxDistance;
+
+    int capacity = 64;
+    int pending = 0;
+    BkPending* heap = malloc(sizeof(BkPending) * capacity);
+    heap = heapPush(heap, &pending, &capacity, tree->root, 0);
+    while (pending > 0)
+    {
+        BkPending next = heapPop(heap, &pending);
+        if (next.bound > radius)
+        {
+            break;
+        }
+        BkNode* node = next.node;
+        int distance = levenshteinDistance(pattern, node->word);
+        tree->visited++;
+
+        if (distance <= radius)
+        {
+            count = suggestionOffer(results, count, k, node->word, distance);
+            radius = suggestionLimit(results, count, k, radius);
+        }
+
+        // Only children within radius of distance can hold a match
+        for (BkNode* child = node->child; child != NULL; child = child->sibling)
+        {
+            int bound = child->edge > distance ? child->edge - distance : distance - child->edge;
+            if (bound <= radius)
+            {
+                heap = heapPush(heap, &pending, &capacity, child, bound);
+            }
+        }
+    }
+    free(heap);
+    levenshteinPatternDelete(pattern);
+    suggestionSort(results, count);
+    return count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints the number of queries and the share of the tree each one visited.
+ * @param tree
+ */
+void bkTreePrintStats(BkTree* tree)
+{
+    assert(tree != NULL);
+    double average = tree->queries ? (double)tree->visited / tree->queries : 0;
+    printf("BK-tree: %ld queries, %.0f of %d words visited per query (%.1f%%)\n",
+           tree->queries, average, tree->size,
+           tree->size ? 100.0 * average / tree->size : 0.0);
+}
@@ -0,0 +1,49 @@
+#ifndef BK_TREE_H
+#define BK_TREE_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * BK-Tree
+ * Description: Header file for a metric tree over edit distance. Each child
+ *              hangs off its parent by its distance to the parent's word, so
+ *              the triangle inequality rules out whole subtrees during a
+ *              nearest word search.
+ *****************************************************************************/
+
+#include "arena.h"
+#include "suggestion.h"
+
+typedef struct BkNode BkNode;
+typedef struct BkTree BkTree;
+
+struct BkNode
+{
+    // Edit distance from the parent's word to this word.
+    int edge;
+    // First child and next child of the same parent.
+    BkNode* child;
+    BkNode* sibling;
+    // Null terminated word stored right after the node.
+    char word[];
+};
+
+struct BkTree
+{
+    BkNode* root;
+    // Nodes and their words.
+    Arena* arena;
+    // Number of words in the tree.
+    int size;
+    // Totals over every bkTreeQuery, to measure how much the tree prunes.
+    long queries;
+    long visited;
+};
+
+BkTree* bkTreeNew();
+void bkTreeDelete(BkTree* tree);
+void bkTreeAdd(BkTree* tree, const char* word);
+int bkTreeQuery(BkTree* tree, const char* word, int k, int maxDistance,
+                Suggestion* results);
+void bkTreePrintStats(BkTree* tree);
+
+#endif
@@ -0,0 +1,225 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Concurrent Hash Map Benchmark
+ * Description: Loads dictionary.txt and measures lookup throughput from 1 to
+ *              N threads, comparing the lock-free reads of ConcurrentMap with
+ *              a HashMap guarded by one global mutex, and ConcurrentMap again
+ *              while a writer thread keeps inserting and removing keys.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "concurrentMap.h"
+#include "hashMap.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOOKUPS_PER_THREAD 2000000
+
+// Words shared by every benchmark thread.
+static char** words;
+static int wordCount;
+
+static ConcurrentMap* concurrent;
+static HashMap* locked;
+static pthread_mutex_t globalLock = PTHREAD_MUTEX_INITIALIZER;
+// Tells the writer thread to stop.
+static volatile int stopWriter;
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a monotonic timestamp in seconds.
+ * @return Seconds since an arbitrary fixed point.
+ ****************************************************************************/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Looks words up in the concurrent map, starting at a different word in each
+ * thread.
+ * @param arg Thread number.
+ * @return Number of hits.
+ ****************************************************************************/
+static void* concurrentReader(void* arg)
+{
+    long hits = 0;
+    int index = (int)(long)arg * 7919 % wordCount;
+    for (int i = 0; i < LOOKUPS_PER_THREAD; i++)
+    {
+        hits += concurrentMapContainsKey(concurrent, words[index]);
+        index = index + 1 == wordCount ? 0 : index + 1;
+    }
+    return (void*)hits;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Looks words up in the HashMap, holding the global lock for each lookup.
+ * @param arg Thread number.
+ * @return Number of hits.
+ ****************************************************************************/
+static void* lockedReader(void* arg)
+{
+    long hits = 0;
+    int index = (int)(long)arg * 7919 % wordCount;
+    for (int i = 0; i < LOOKUPS_PER_THREAD; i++)
+    {
+        pthread_mutex_lock(&globalLock);
+        hits += hashMapContainsKey(locked, words[index]);
+        pthread_mutex_unlock(&globalLock);
+        index = index + 1 == wordCount ? 0 : index + 1;
+    }
+    return (void*)hits;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Inserts and removes keys that are not in the dictionary until stopped,
+ * forcing writes, retirement and resizes while the readers run.
+ * @param arg Unused.
+ * @return Number of writes.
+ ****************************************************************************/
+static void* writer(void* arg)
+{
+    long writes = 0;
+    char key[32];
+    while (!stopWriter)
+    {
+        sprintf(key, "#%ld", writes % 200000);
+        if ((writes / 200000) % 2 == 0)
+        {
+            concurrentMapPut(concurrent, key, (int)writes);
+        }
+        else
+        {
+            concurrentMapRemove(concurrent, key);
+        }
+        writes++;
+    }
+    return (void*)writes;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Runs threads copies of reader and returns the lookups per second achieved.
+ * @param reader Thread function.
+ * @param threads
+ * @param withWriter Run the writer thread alongside the readers.
+ * @return Lookups per second over all threads.
+ ****************************************************************************/
+static double run(void* (*reader)(void*), int threads, int withWriter)
+{
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    pthread_t writerId;
+    stopWriter = 0;
+    if (withWriter)
+    {
+        pthread_create(&writerId, NULL, writer, NULL);
+    }
+
+    double start = now();
+    for (long t = 0; t < threads; t++)
+    {
+        pthread_create(&ids[t], NULL, reader, (void*)t);
+    }
+    long hits = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        void* result;
+        pthread_join(ids[t], &result);
+        hits += (long)result;
+    }
+    double elapsed = now() - start;
+
+    if (withWriter)
+    {
+        stopWriter = 1;
+        pthread_join(writerId, NULL);
+    }
+    free(ids);
+    if (hits != (long)threads * LOOKUPS_PER_THREAD)
+    {
+        printf("lookups missed %ld words\n", (long)threads * LOOKUPS_PER_THREAD - hits);
+    }
+    return (double)threads * LOOKUPS_PER_THREAD / elapsed;
+}
+
+
+/*** MAIN *********************************************************************
+ * Usage: concurrentBench [max threads] [dictionary]
+ * Thread counts double from 1 up to max threads, which defaults to twice the
+ * number of online cores.
+ * @param argc
+ * @param argv
+ * @return
+ ****************************************************************************/
+int main(int argc, const char** argv)
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : 2 * (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* path = argc > 2 ? argv[2] : "dictionary.txt";
+    FILE* file = fopen(path, "r");
+    if (file == NULL || maxThreads < 1)
+    {
+        printf("usage: concurrentBench [max threads] [dictionary]\n");
+        return 1;
+    }
+
+    // Read the dictionary into both maps
+    int capacity = 1024;
+    char line[256];
+    words = malloc(sizeof(char*) * capacity);
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+        {
+            continue;
+        }
+        if (wordCount == capacity)
+        {
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[wordCount++] = strdup(line);
+    }
+    fclose(file);
+
+    concurrent = concurrentMapNew(1000);
+    locked = hashMapNew(1000);
+    hashMapSetHash(locked, hashFnv1a, 0);
+    hashMapUseArena(locked);
+    for (int i = 0; i < wordCount; i++)
+    {
+        concurrentMapPut(concurrent, words[i], i);
+        hashMapPut(locked, words[i], i);
+    }
+
+    printf("%d words, %d lookups per thread\n", wordCount, LOOKUPS_PER_THREAD);
+    printf("%8s %18s %18s %18s\n", "threads", "mutex Mops/s", "lock-free Mops/s",
+           "+writer Mops/s");
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double mutex = run(lockedReader, threads, 0);
+        double lockFree = run(concurrentReader, threads, 0);
+        double busy = run(concurrentReader, threads, 1);
+        printf("%8d %18.2f %18.2f %18.2f\n", threads, mutex / 1e6, lockFree / 1e6,
+               busy / 1e6);
+    }
+
+    concurrentMapDelete(concurrent);
+    hashMapDelete(locked);
+    for (int i = 0; i < wordCount; i++)
+    {
+        free(words[i]);
+    }
+    free(words);
+    return 0;
+}
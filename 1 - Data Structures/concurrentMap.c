@@ -0,0 +1,430 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Concurrent Hash Map
+ * Description: Thread-safe chained hash map. Readers walk the chains without
+ *              locking, relying on writers to publish every change with a
+ *              single pointer store. Writers serialize per stripe of buckets.
+ *              Unlinked links and replaced tables are only freed once every
+ *              reader that could still be looking at them has finished, which
+ *              is tracked with per-slot reader counters and an epoch flip.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "concurrentMap.h"
+#include <assert.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reader slot of the calling thread, assigned on first use.
+static __thread int readerSlot = -1;
+// Next reader slot to hand out.
+static int nextReaderSlot = 0;
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the calling thread's reader counter slot.
+ * @param map
+ * @return The thread's slot.
+ */
+static ReaderSlot* readerSlotOf(ConcurrentMap* map)
+{
+    if (readerSlot < 0)
+    {
+        readerSlot = __atomic_fetch_add(&nextReaderSlot, 1, __ATOMIC_RELAXED) % CONCURRENT_READER_SLOTS;
+    }
+    return &map->readers[readerSlot];
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Marks the calling thread as reading the map. Nothing the thread can reach
+ * until readerExit is freed.
+ * @param map
+ * @param slot The thread's reader slot.
+ * @return Counter the thread registered in, to pass to readerExit.
+ */
+static long* readerEnter(ConcurrentMap* map, ReaderSlot* slot)
+{
+    while (1)
+    {
+        long epoch = __atomic_load_n(&map->epoch, __ATOMIC_SEQ_CST);
+        long* counter = &slot->active[epoch & 1];
+        __atomic_fetch_add(counter, 1, __ATOMIC_SEQ_CST);
+
+        // Retry if a writer flipped the epoch before the count landed
+        if (__atomic_load_n(&map->epoch, __ATOMIC_SEQ_CST) == epoch)
+        {
+            return counter;
+        }
+        __atomic_fetch_sub(counter, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Marks the calling thread as done reading.
+ * @param counter Counter returned by readerEnter.
+ */
+static void readerExit(long* counter)
+{
+    __atomic_fetch_sub(counter, 1, __ATOMIC_RELEASE);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Waits until every reader that started before the call has finished. The
+ * caller holds retireLock, so only one grace period runs at a time.
+ * @param map
+ */
+static void waitForReaders(ConcurrentMap* map)
+{
+    // Send new readers to the other counter, then drain the current one
+    long epoch = __atomic_fetch_add(&map->epoch, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < CONCURRENT_READER_SLOTS; i++)
+    {
+        while (__atomic_load_n(&map->readers[i].active[epoch & 1], __ATOMIC_SEQ_CST) != 0)
+        {
+            sched_yield();
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees a table along with every link in its buckets.
+ * @param table
+ */
+static void tableFree(ConcurrentTable* table)
+{
+    for (int i = 0; i < table->capacity; i++)
+    {
+        ConcurrentLink* link = table->buckets[i];
+        while (link != NULL)
+        {
+            ConcurrentLink* next = link->next;
+            free(link);
+            link = next;
+        }
+    }
+    free(table);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees a retired list.
+ * @param garbage
+ */
+static void freeRetired(Retired* garbage)
+{
+    while (garbage != NULL)
+    {
+        Retired* next = garbage->next;
+        if (garbage->table)
+        {
+            tableFree(garbage->ptr);
+        }
+        else
+        {
+            free(garbage->ptr);
+        }
+        free(garbage);
+        garbage = next;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Queues memory readers may still hold. Once CONCURRENT_RETIRE_BATCH pieces
+ * are queued, or a whole table is, the writer waits out one grace period and
+ * frees the batch.
+ * @param map
+ * @param ptr A link, or a table with its links, no longer reachable from the
+ *            map.
+ * @param table Set when ptr is a table.
+ */
+static void retire(ConcurrentMap* map, void* ptr, int table)
+{
+    Retired* entry = malloc(sizeof(Retired));
+    entry->ptr = ptr;
+    entry->table = table;
+
+    pthread_mutex_lock(&map->retireLock);
+    entry->next = map->retired;
+    map->retired = entry;
+    map->retiredCount++;
+
+    Retired* garbage = NULL;
+    if (table || map->retiredCount >= CONCURRENT_RETIRE_BATCH)
+    {
+        waitForReaders(map);
+        garbage = map->retired;
+        map->retired = NULL;
+        map->retiredCount = 0;
+    }
+    pthread_mutex_unlock(&map->retireLock);
+    freeRetired(garbage);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Allocates an empty table.
+ * @param capacity Power of two number of buckets.
+ * @return The table.
+ */
+static ConcurrentTable* tableNew(int capacity)
+{
+    ConcurrentTable* table = calloc(1, sizeof(ConcurrentTable) + sizeof(ConcurrentLink*) * capacity);
+    table->capacity = capacity;
+    return table;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates an empty concurrent map.
+ * @param capacity Minimum number of buckets.
+ * @return The allocated map.
+ */
+ConcurrentMap* concurrentMapNew(int capacity)
+{
+    ConcurrentMap* map = calloc(1, sizeof(ConcurrentMap));
+    int buckets = CONCURRENT_STRIPES;
+    while (buckets < capacity)
+    {
+        buckets *= 2;
+    }
+    map->table = tableNew(buckets);
+    map->hash = hashFnv1a;
+    map->seed = 0;
+    for (int i = 0; i < CONCURRENT_STRIPES; i++)
+    {
+        pthread_mutex_init(&map->stripes[i], NULL);
+    }
+    pthread_mutex_init(&map->retireLock, NULL);
+    return map;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the map and everything in it. No other thread may be using the map.
+ * @param map
+ */
+void concurrentMapDelete(ConcurrentMap* map)
+{
+    assert(map != NULL);
+    tableFree(map->table);
+    freeRetired(map->retired);
+    for (int i = 0; i < CONCURRENT_STRIPES; i++)
+    {
+        pthread_mutex_destroy(&map->stripes[i]);
+    }
+    pthread_mutex_destroy(&map->retireLock);
+    free(map);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the link holding key in the current table. The caller is a registered
+ * reader or holds the key's stripe lock.
+ * @param map
+ * @param key
+ * @param hash
+ * @return The link or NULL.
+ */
+static ConcurrentLink* findLink(ConcurrentMap* map, const char* key, unsigned int hash)
+{
+    ConcurrentTable* table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+    ConcurrentLink* link = __atomic_load_n(&table->buckets[hash & (table->capacity - 1)], __ATOMIC_ACQUIRE);
+    while (link != NULL && (link->hash != hash || strcmp(link->key, key) != 0))
+    {
+        link = __atomic_load_n(&link->next, __ATOMIC_ACQUIRE);
+    }
+    return link;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Looks up a key without taking any lock.
+ * @param map
+ * @param key
+ * @param value Set to the key's value if it is found. May be NULL.
+ * @return 1 if the key is found, 0 otherwise.
+ */
+int concurrentMapGet(ConcurrentMap* map, const char* key, int* value)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    unsigned int hash = map->hash(key, map->seed);
+
+    long* counter = readerEnter(map, readerSlotOf(map));
+    ConcurrentLink* link = findLink(map, key, hash);
+    if (link != NULL && value != NULL)
+    {
+        *value = __atomic_load_n(&link->value, __ATOMIC_RELAXED);
+    }
+    readerExit(counter);
+    return link != NULL;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns 1 if the key is in the map and 0 otherwise, without taking a lock.
+ * @param map
+ * @param key
+ * @return 1 if the key is found, 0 otherwise.
+ */
+int concurrentMapContainsKey(ConcurrentMap* map, const char* key)
+{
+    return concurrentMapGet(map, key, NULL);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Doubles the table. Every stripe is locked so no writer changes a chain, the
+ * links are copied into a new table, and the new table is published with one
+ * pointer store. Readers keep walking the old table until they finish, after
+ * which it is freed.
+ * @param map
+ * @param seen Capacity the caller saw; nothing happens if another writer has
+ *             already resized.
+ */
+static void resize(ConcurrentMap* map, int seen)
+{
+    for (int i = 0; i < CONCURRENT_STRIPES; i++)
+    {
+        pthread_mutex_lock(&map->stripes[i]);
+    }
+
+    ConcurrentTable* old = map->table;
+    if (old->capacity == seen)
+    {
+        // Copy each chain into the new table
+        ConcurrentTable* table = tableNew(2 * old->capacity);
+        for (int i = 0; i < old->capacity; i++)
+        {
+            for (ConcurrentLink* link = old->buckets[i]; link != NULL; link = link->next)
+            {
+                size_t bytes = sizeof(ConcurrentLink) + strlen(link->key) + 1;
+                ConcurrentLink* copy = malloc(bytes);
+                memcpy(copy, link, bytes);
+                int index = link->hash & (table->capacity - 1);
+                copy->next = table->buckets[index];
+                table->buckets[index] = copy;
+            }
+        }
+        __atomic_store_n(&map->table, table, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        old = NULL;
+    }
+
+    for (int i = CONCURRENT_STRIPES - 1; i >= 0; i--)
+    {
+        pthread_mutex_unlock(&map->stripes[i]);
+    }
+
+    // Free the old links and table once their readers are gone
+    if (old != NULL)
+    {
+        retire(map, old, 1);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Updates the key's value, or adds the key to the front of its bucket. Only
+ * the key's stripe is locked. Resizes once the load reaches MAX_TABLE_LOAD.
+ * @param map
+ * @param key
+ * @param value
+ */
+void concurrentMapPut(ConcurrentMap* map, const char* key, int value)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    unsigned int hash = map->hash(key, map->seed);
+    pthread_mutex_t* stripe = &map->stripes[hash & (CONCURRENT_STRIPES - 1)];
+
+    pthread_mutex_lock(stripe);
+    ConcurrentTable* table = map->table;
+    int added = 0;
+    ConcurrentLink* link = findLink(map, key, hash);
+    if (link != NULL)
+    {
+        __atomic_store_n(&link->value, value, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        // Fill in the link completely before publishing it
+        size_t length = strlen(key) + 1;
+        link = malloc(sizeof(ConcurrentLink) + length);
+        memcpy(link->key, key, length);
+        link->hash = hash;
+        link->value = value;
+        ConcurrentLink** bucket = &table->buckets[hash & (table->capacity - 1)];
+        link->next = *bucket;
+        __atomic_store_n(bucket, link, __ATOMIC_RELEASE);
+        added = 1;
+    }
+    // A resize may free table once the stripe is unlocked
+    int capacity = table->capacity;
+    pthread_mutex_unlock(stripe);
+
+    if (added)
+    {
+        int size = __atomic_add_fetch(&map->size, 1, __ATOMIC_RELAXED);
+        if (size >= capacity * MAX_TABLE_LOAD)
+        {
+            resize(map, capacity);
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Unlinks the key from its bucket under the key's stripe lock. The link is
+ * freed after the readers that may be on it are done.
+ * @param map
+ * @param key
+ */
+void concurrentMapRemove(ConcurrentMap* map, const char* key)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    unsigned int hash = map->hash(key, map->seed);
+    pthread_mutex_t* stripe = &map->stripes[hash & (CONCURRENT_STRIPES - 1)];
+
+    pthread_mutex_lock(stripe);
+    ConcurrentTable* table = map->table;
+    ConcurrentLink** prev = &table->buckets[hash & (table->capacity - 1)];
+    ConcurrentLink* link = *prev;
+    while (link != NULL && (link->hash != hash || strcmp(link->key, key) != 0))
+    {
+        prev = &link->next;
+        link = link->next;
+    }
+    if (link != NULL)
+    {
+        __atomic_store_n(prev, link->next, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(stripe);
+
+    if (link != NULL)
+    {
+        __atomic_sub_fetch(&map->size, 1, __ATOMIC_RELAXED);
+        retire(map, link, 0);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of keys in the map.
+ * @param map
+ * @return Number of keys.
+ */
+int concurrentMapSize(ConcurrentMap* map)
+{
+    assert(map != NULL);
+    return __atomic_load_n(&map->size, __ATOMIC_RELAXED);
+}
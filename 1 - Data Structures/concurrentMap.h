@@ -0,0 +1,87 @@
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Concurrent Hash Map
+ * Description: Header file for a thread-safe chained hash map with the same
+ *              operations as the Hash Map ADT. Lookups never take a lock,
+ *              writers lock one stripe of the buckets, and resizing copies the
+ *              table aside so readers keep going while it happens.
+ *****************************************************************************/
+
+#include "hashMap.h"
+#include <pthread.h>
+
+// Number of writer locks. Buckets share the lock of their hash's low bits.
+#define CONCURRENT_STRIPES 64
+// Number of reader counters threads are spread over.
+#define CONCURRENT_READER_SLOTS 64
+// Removed links are freed in batches of this many.
+#define CONCURRENT_RETIRE_BATCH 256
+// Bytes each reader counter is padded to, so readers do not share lines.
+#define CACHE_LINE 64
+
+typedef struct ConcurrentLink ConcurrentLink;
+typedef struct ConcurrentTable ConcurrentTable;
+typedef struct ConcurrentMap ConcurrentMap;
+
+struct ConcurrentLink
+{
+    ConcurrentLink* next;
+    unsigned int hash;
+    int value;
+    // Null terminated key stored right after the link.
+    char key[];
+};
+
+struct ConcurrentTable
+{
+    // Power of two number of buckets, at least CONCURRENT_STRIPES.
+    int capacity;
+    ConcurrentLink* buckets[];
+};
+
+// Reader counter padded to a cache line of its own.
+typedef struct ReaderSlot
+{
+    long active[2];
+    char pad[CACHE_LINE - 2 * sizeof(long)];
+} ReaderSlot;
+
+// Memory waiting for every reader that might still see it to finish.
+typedef struct Retired
+{
+    void* ptr;
+    // Set when ptr is a whole ConcurrentTable rather than one link.
+    int table;
+    struct Retired* next;
+} Retired;
+
+struct ConcurrentMap
+{
+    // Current table, swapped atomically on resize.
+    ConcurrentTable* table;
+    int size;
+    HashFunction hash;
+    unsigned int seed;
+    pthread_mutex_t stripes[CONCURRENT_STRIPES];
+
+    // Grace period tracking. Readers count themselves in active[epoch & 1]
+    // of their slot, writers wait for the other parity to drain.
+    long epoch;
+    ReaderSlot readers[CONCURRENT_READER_SLOTS];
+    pthread_mutex_t retireLock;
+    Retired* retired;
+    int retiredCount;
+};
+
+ConcurrentMap* concurrentMapNew(int capacity);
+void concurrentMapDelete(ConcurrentMap* map);
+int concurrentMapGet(ConcurrentMap* map, const char* key, int* value);
+void concurrentMapPut(ConcurrentMap* map, const char* key, int value);
+void concurrentMapRemove(ConcurrentMap* map, const char* key);
+int concurrentMapContainsKey(ConcurrentMap* map, const char* key);
+int concurrentMapSize(ConcurrentMap* map);
+
+#endif
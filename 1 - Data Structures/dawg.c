@@ -0,0 +1,692 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * DAWG
+ * Description: Directed acyclic word graph built from sorted words with the
+ *              incremental minimization of Daciuk et al.: once a word is
+ *              added, the nodes only the previous word reached can no longer
+ *              change, so each is merged with an identical node built earlier
+ *              or registered as a new one. The minimal graph is then packed
+ *              into an array of edges.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dawg.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// Edge of a node while the graph is being built.
+typedef struct BuildEdge
+{
+    unsigned char label;
+    int child;
+} BuildEdge;
+
+// Node while the graph is being built.
+typedef struct BuildNode
+{
+    int final;
+    BuildEdge* edges;
+    int edgeCount;
+    int edgeCapacity;
+    // First packed edge, or 0 until the node is packed.
+    uint32_t position;
+    int packed;
+} BuildNode;
+
+// Graph under construction.
+typedef struct DawgBuilder
+{
+    BuildNode* nodes;
+    int nodeCount;
+    int nodeCapacity;
+    // Signature of each registered node to its number. See nodeSignature.
+    HashMap* registry;
+    // Nodes along the previous word, path[0] being the root.
+    int* path;
+    int pathLength;
+    // Packed edges and how many are in use.
+    uint32_t* edges;
+    int edgeCount;
+    int edgeCapacity;
+    int packedNodes;
+} DawgBuilder;
+
+// State shared by one dawgQuery walk.
+typedef struct DawgSearch
+{
+    Dawg* dawg;
+    const char* word;
+    int length;
+    // Levenshtein row of the query against the letters walked so far, one
+    // row of length + 1 entries for each depth.
+    int* rows;
+    // Letters walked so far.
+    char* buffer;
+    int k;
+    int count;
+    int radius;
+    Suggestion* results;
+} DawgSearch;
+
+/*** IMPLEMENT ***************************************************************
+ * Compares two words for qsort.
+ * @param a Pointer to a word.
+ * @param b Pointer to a word.
+ * @return strcmp of the words.
+ */
+static int compareWords(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Adds a node with no edges to the graph under construction.
+ * @param builder
+ * @return The node's number.
+ */
+static int buildNodeNew(DawgBuilder* builder)
+{
+    if (builder->nodeCount == builder->nodeCapacity)
+    {
+        builder->nodeCapacity *= 2;
+        builder->nodes = realloc(builder->nodes, sizeof(BuildNode) * builder->nodeCapacity);
+    }
+    BuildNode* node = &builder->nodes[builder->nodeCount];
+    node->final = 0;
+    node->edges = NULL;
+    node->edgeCount = 0;
+    node->edgeCapacity = 0;
+    node->position = 0;
+    node->packed = 0;
+    return builder->nodeCount++;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Appends an edge to a node. Words arrive sorted, so edges arrive in label
+ * order.
+ * @param builder
+ * @param parent
+ * @param label
+ * @param child
+ */
+static void buildEdgeAdd(DawgBuilder* builder, int parent, unsigned char label, int child)
+{
+    BuildNode* node = &builder->nodes[parent];
+    if (node->edgeCount == node->edgeCapacity)
+    {
+        node->edgeCapacity = node->edgeCapacity ? 2 * node->edgeCapacity : 2;
+        node->edges = realloc(node->edges, sizeof(BuildEdge) * node->edgeCapacity);
+    }
+    node->edges[node->edgeCount].label = label;
+    node->edges[node->edgeCount].child = child;
+    node->edgeCount++;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Writes a string that two nodes share exactly when they are interchangeable:
+ * the final flag, then each edge's label followed by its child's number and
+ * a comma. Children are registered before their parents, so equal children
+ * already have equal numbers.
+ * @param node
+ * @param signature Buffer of at least 2 + 12 * edgeCount bytes.
+ */
+static void nodeSignature(const BuildNode* node, char* signature)
+{
+    char* end = signature;
+    *end++ = node->final ? '1' : '0';
+    for (int i = 0; i < node->edgeCount; i++)
+    {
+        *end++ = (char)node->edges[i].label;
+        end += sprintf(end, "%d,", node->edges[i].child);
+    }
+    *end = '\0';
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Merges or registers the nodes of the previous word below depth, deepest
+ * first. A node equal to a registered one is replaced by it in its parent's
+ * last edge and freed.
+ * @param builder
+ * @param depth Nodes at or above this depth are left alone.
+ */
+static void minimize(DawgBuilder* builder, int depth)
+{
+    char stackSignature[512];
+    for (int d = builder->pathLength; d > depth; d--)
+    {
+        int child = builder->path[d];
+        BuildNode* node = &builder->nodes[child];
+        size_t size = 2 + 12 * (size_t)node->edgeCount;
+        char* signature = size <= sizeof(stackSignature) ? stackSignature : malloc(size);
+        nodeSignature(node, signature);
+
+        int* existing = hashMapGet(builder->registry, signature);
+        if (existing != NULL)
+        {
+            BuildNode* parent = &builder->nodes[builder->path[d - 1]];
+            parent->edges[parent->edgeCount - 1].child = *existing;
+            free(node->edges);
+            node->edges = NULL;
+            node->edgeCount = 0;
+        }
+        else
+        {
+            hashMapPut(builder->registry, signature, child);
+        }
+        if (signature != stackSignature)
+        {
+            free(signature);
+        }
+    }
+    builder->pathLength = depth;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Packs a node's edges, and everything below them, into the edge array the
+ * first time the node is reached.
+ * @param builder
+ * @param n Node number.
+ * @return Index of the node's first edge, or 0 if it has none.
+ */
+static uint32_t pack(DawgBuilder* builder, int n)
+{
+    BuildNode* node = &builder->nodes[n];
+    if (node->packed)
+    {
+        return node->position;
+    }
+    node->packed = 1;
+    builder->packedNodes++;
+    if (node->edgeCount == 0)
+    {
+        return 0;
+    }
+
+    // Reserve the node's edges before packing its children after them
+    int edgeCount = node->edgeCount;
+    uint32_t position = builder->edgeCount;
+    assert((uint32_t)builder->edgeCount + edgeCount < DAWG_MAX_EDGES);
+    while (builder->edgeCount + edgeCount > builder->edgeCapacity)
+    {
+        builder->edgeCapacity *= 2;
+        builder->edges = realloc(builder->edges, sizeof(uint32_t) * builder->edgeCapacity);
+    }
+    builder->edgeCount += edgeCount;
+    node->position = position;
+
+    for (int i = 0; i < edgeCount; i++)
+    {
+        BuildEdge edge = node->edges[i];
+        uint32_t child = pack(builder, edge.child);
+        builder->edges[position + i] = edge.label |
+                                       (builder->nodes[edge.child].final ? DAWG_FINAL : 0) |
+                                       (i == edgeCount - 1 ? DAWG_LAST : 0) |
+                                       child << DAWG_CHILD_SHIFT;
+    }
+    return position;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds the minimal graph of a list of words. The words may be in any order
+ * and may repeat; empty words are ignored.
+ * @param words
+ * @param count Number of words.
+ * @return The allocated graph.
+ */
+Dawg* dawgNew(const char** words, int count)
+{
+    assert(words != NULL || count == 0);
+    const char** sorted = malloc(sizeof(char*) * (count + 1));
+    memcpy(sorted, words, sizeof(char*) * count);
+    qsort(sorted, count, sizeof(char*), compareWords);
+
+    DawgBuilder builder;
+    builder.nodeCapacity = 1024;
+    builder.nodeCount = 0;
+    builder.nodes = malloc(sizeof(BuildNode) * builder.nodeCapacity);
+    builder.registry = hashMapNew(1000);
+    hashMapSetHash(builder.registry, hashFnv1a, 0);
+    hashMapUseArena(builder.registry);
+    int pathCapacity = 64;
+    builder.path = malloc(sizeof(int) * pathCapacity);
+    builder.path[0] = buildNodeNew(&builder);
+    builder.pathLength = 0;
+
+    Dawg* dawg = malloc(sizeof(Dawg));
+    dawg->wordCount = 0;
+    dawg->maxLength = 0;
+    const char* previous = "";
+    for (int i = 0; i < count; i++)
+    {
+        const char* word = sorted[i];
+        int length = strlen(word);
+        if (length == 0 || strcmp(word, previous) == 0)
+        {
+            continue;
+        }
+
+        // Nodes past the prefix shared with the previous word are finished
+        int shared = 0;
+        while (shared < builder.pathLength && word[shared] == previous[shared])
+        {
+            shared++;
+        }
+        minimize(&builder, shared);
+
+        // Hang the rest of the word off the shared prefix
+        if (length >= pathCapacity)
+        {
+            pathCapacity = 2 * length;
+            builder.path = realloc(builder.path, sizeof(int) * pathCapacity);
+        }
+        for (int d = shared; d < length; d++)
+        {
+            int child = buildNodeNew(&builder);
+            buildEdgeAdd(&builder, builder.path[d], (unsigned char)word[d], child);
+            builder.path[d + 1] = child;
+        }
+        builder.pathLength = length;
+        builder.nodes[builder.path[length]].final = 1;
+
+        dawg->wordCount++;
+        if (length > dawg->maxLength)
+        {
+            dawg->maxLength = length;
+        }
+        previous = word;
+    }
+    minimize(&builder, 0);
+
+    // Pack the graph, leaving edge 0 unused so 0 can mean no edges
+    builder.edgeCapacity = 1024;
+    builder.edgeCount = 1;
+    builder.edges = malloc(sizeof(uint32_t) * builder.edgeCapacity);
+    builder.edges[0] = 0;
+    builder.packedNodes = 0;
+    dawg->root = pack(&builder, 0);
+    dawg->edges = realloc(builder.edges, sizeof(uint32_t) * builder.edgeCount);
+    dawg->edgeCount = builder.edgeCount;
+    dawg->nodeCount = builder.packedNodes;
+
+    dawg->interned = hashMapNewLayout(1000, HASH_MAP_OPEN);
+    dawg->spelledCapacity = 64;
+    dawg->spelled = malloc(sizeof(char*) * dawg->spelledCapacity);
+    dawg->queries = 0;
+    dawg->visited = 0;
+
+    for (int i = 0; i < builder.nodeCount; i++)
+    {
+        free(builder.nodes[i].edges);
+    }
+    free(builder.nodes);
+    free(builder.path);
+    hashMapDelete(builder.registry);
+    free(sorted);
+    return dawg;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the graph and every word dawgQuery returned.
+ * @param dawg
+ */
+void dawgDelete(Dawg* dawg)
+{
+    assert(dawg != NULL);
+    for (int i = 0; i < hashMapSize(dawg->interned); i++)
+    {
+        free(dawg->spelled[i]);
+    }
+    free(dawg->spelled);
+    hashMapDelete(dawg->interned);
+    free(dawg->edges);
+    free(dawg);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the edge leaving a node with a given label.
+ * @param dawg
+ * @param index First edge of the node, or 0 for a node without edges.
+ * @param label
+ * @return Index of the edge, or 0 if there is none.
+ */
+static uint32_t findEdge(Dawg* dawg, uint32_t index, unsigned char label)
+{
+    if (index == 0)
+    {
+        return 0;
+    }
+    while (1)
+    {
+        uint32_t edge = dawg->edges[index];
+        unsigned char edgeLabel = edge & 0xff;
+        if (edgeLabel == label)
+        {
+            return index;
+        }
+        // Labels ascend, so a larger one means the label is missing
+        if (edgeLabel > label || (edge & DAWG_LAST))
+        {
+            return 0;
+        }
+        index++;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns whether a word is in the graph. Takes the place of
+ * hashMapContainsKey for a dictionary.
+ * @param dawg
+ * @param word
+ * @return 1 if the word is in the graph, 0 otherwise.
+ */
+int dawgContains(Dawg* dawg, const char* word)
+{
+    assert(dawg != NULL && word != NULL);
+    const unsigned char* letter = (const unsigned char*)word;
+    if (*letter == '\0')
+    {
+        return 0;
+    }
+    uint32_t index = dawg->root;
+    while (1)
+    {
+        index = findEdge(dawg, index, *letter);
+        if (index == 0)
+        {
+            return 0;
+        }
+        uint32_t edge = dawg->edges[index];
+        if (*++letter == '\0')
+        {
+            return (edge & DAWG_FINAL) != 0;
+        }
+        index = edge >> DAWG_CHILD_SHIFT;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Visits the words below a node in alphabetical order.
+ * @param dawg
+ * @param index First edge of the node.
+ * @param buffer Letters leading to the node, with room for the longest word.
+ * @param depth Number of letters in buffer.
+ * @param left Words still to visit, updated.
+ * @param visit
+ * @param arg
+ */
+static void completeFrom(Dawg* dawg, uint32_t index, char* buffer, int depth,
+                         int* left, DawgVisit visit, void* arg)
+{
+    if (index == 0)
+    {
+        return;
+    }
+    while (*left > 0)
+    {
+        uint32_t edge = dawg->edges[index];
+        buffer[depth] = (char)(edge & 0xff);
+        if (edge & DAWG_FINAL)
+        {
+            buffer[depth + 1] = '\0';
+            visit(buffer, arg);
+            (*left)--;
+        }
+        completeFrom(dawg, edge >> DAWG_CHILD_SHIFT, buffer, depth + 1, left, visit, arg);
+        if (edge & DAWG_LAST)
+        {
+            break;
+        }
+        index++;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Visits the words starting with a prefix, the prefix itself included, in
+ * alphabetical order. The word passed to visit is only valid during the call.
+ * @param dawg
+ * @param prefix
+ * @param limit Most words to visit.
+ * @param visit Called with each word and arg.
+ * @param arg
+ * @return Number of words visited.
+ */
+int dawgComplete(Dawg* dawg, const char* prefix, int limit, DawgVisit visit, void* arg)
+{
+    assert(dawg != NULL && prefix != NULL && visit != NULL);
+    int length = strlen(prefix);
+    if (length > dawg->maxLength || limit <= 0)
+    {
+        return 0;
+    }
+
+    // Walk to the node the prefix ends at
+    char* buffer = malloc(dawg->maxLength + 1);
+    memcpy(buffer, prefix, length + 1);
+    int left = limit;
+    uint32_t index = dawg->root;
+    for (int i = 0; i < length && index != 0; i++)
+    {
+        index = findEdge(dawg, index, (unsigned char)prefix[i]);
+        if (index == 0)
+        {
+            break;
+        }
+        uint32_t edge = dawg->edges[index];
+        if (i == length - 1 && (edge & DAWG_FINAL))
+        {
+            visit(buffer, arg);
+            left--;
+        }
+        index = edge >> DAWG_CHILD_SHIFT;
+    }
+    completeFrom(dawg, index, buffer, length, &left, visit, arg);
+    free(buffer);
+    return limit - left;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a lasting copy of a word found by a query, making one the first
+ * time the word is found.
+ * @param dawg
+ * @param word
+ * @return The copy.
+ */
+static const char* intern(Dawg* dawg, const char* word)
+{
+    int* number = hashMapGet(dawg->interned, word);
+    if (number != NULL)
+    {
+        return dawg->spelled[*number];
+    }
+    int count = hashMapSize(dawg->interned);
+    if (count == dawg->spelledCapacity)
+    {
+        dawg->spelledCapacity *= 2;
+        dawg->spelled = realloc(dawg->spelled, sizeof(char*) * dawg->spelledCapacity);
+    }
+    dawg->spelled[count] = strdup(word);
+    hashMapPut(dawg->interned, word, count);
+    return dawg->spelled[count];
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the largest distance a word found later in the walk can have and
+ * still be kept. Words are found alphabetically, so once k are held a later
+ * word only displaces one by being strictly closer.
+ * @param search
+ * @return Distance limit.
+ */
+static int searchLimit(DawgSearch* search)
+{
+    if (search->count == search->k && search->results[0].distance <= search->radius)
+    {
+        return search->results[0].distance - 1;
+    }
+    return search->radius;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Walks the edges of a node, extending the query's Levenshtein row by each
+ * edge's letter. A row's smallest entry never shrinks further down, so a
+ * branch whose row is all beyond the limit is skipped, which makes the rows
+ * act as a Levenshtein automaton bounded by the limit.
+ * @param search
+ * @param index First edge of the node.
+ * @param depth Letters walked to reach the node.
+ */
+static void searchFrom(DawgSearch* search, uint32_t index, int depth)
+{
+    int width = search->length + 1;
+    const int* previous = search->rows + depth * width;
+    int* row = search->rows + (depth + 1) * width;
+    while (1)
+    {
+        uint32_t edge = search->dawg->edges[index];
+        char label = (char)(edge & 0xff);
+        search->dawg->visited++;
+
+        // Next row of the edit distance table. Entries further than limit
+        // from the diagonal exceed limit, so only the band between is
+        // computed, with limit + 1 standing in at either side of it.
+        int limit = searchLimit(search);
+        int low = depth + 1 - limit > 1 ? depth + 1 - limit : 1;
+        int high = depth + 1 + limit < search->length ? depth + 1 + limit : search->length;
+        row[0] = depth + 1;
+        if (low > 1 && low <= width)
+        {
+            row[low - 1] = limit + 1;
+        }
+        if (high < search->length)
+        {
+            row[high + 1] = limit + 1;
+        }
+        int lowest = row[0];
+        for (int j = low; j <= high; j++)
+        {
+            int cost = previous[j - 1] + (search->word[j - 1] != label);
+            int insert = row[j - 1] + 1;
+            int remove = previous[j] + 1;
+            row[j] = cost < insert ? (cost < remove ? cost : remove) : (insert < remove ? insert : remove);
+            if (row[j] < lowest)
+            {
+                lowest = row[j];
+            }
+        }
+        search->buffer[depth] = label;
+
+        if ((edge & DAWG_FINAL) && high == search->length && row[width - 1] <= limit)
+        {
+            search->buffer[depth + 1] = '\0';
+            search->count = suggestionOffer(search->results, search->count, search->k,
+                                            intern(search->dawg, search->buffer),
+                                            row[width - 1]);
+            limit = searchLimit(search);
+        }
+        uint32_t child = edge >> DAWG_CHILD_SHIFT;
+        if (child != 0 && lowest <= limit)
+        {
+            searchFrom(search, child, depth + 1);
+        }
+        if (edge & DAWG_LAST)
+        {
+            break;
+        }
+        index++;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the k words closest to a word, ties broken alphabetically. The graph
+ * is walked with a radius of 0, then 1, and so on, since a small radius
+ * prunes nearly everything and a word is usually close to k others.
+ * Returned words stay valid until the graph is deleted.
+ * @param dawg
+ * @param word Query.
+ * @param k Maximum number of results.
+ * @param maxDistance Largest distance a result may have.
+ * @param results Array of at least k results, filled closest first.
+ * @return Number of results found.
+ */
+int dawgQuery(Dawg* dawg, const char* word, int k, int maxDistance, Suggestion* results)
+{
+    assert(dawg != NULL && word != NULL && results != NULL);
+    dawg->queries++;
+    if (dawg->root == 0 || k <= 0)
+    {
+        return 0;
+    }
+
+    DawgSearch search;
+    search.dawg = dawg;
+    search.word = word;
+    search.length = strlen(word);
+    search.rows = malloc(sizeof(int) * (search.length + 1) * (dawg->maxLength + 1));
+    search.buffer = malloc(dawg->maxLength + 1);
+    search.k = k;
+    search.results = results;
+    for (int j = 0; j <= search.length; j++)
+    {
+        search.rows[j] = j;
+    }
+
+    for (search.radius = 0; search.radius <= maxDistance; search.radius++)
+    {
+        search.count = 0;
+        searchFrom(&search, dawg->root, 0);
+        if (search.count == k)
+        {
+            break;
+        }
+    }
+    free(search.rows);
+    free(search.buffer);
+    suggestionSort(results, search.count);
+    return search.count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes the graph occupies, not counting words returned by
+ * dawgQuery.
+ * @param dawg
+ * @return Bytes used.
+ */
+size_t dawgBytes(Dawg* dawg)
+{
+    assert(dawg != NULL);
+    return sizeof(Dawg) + sizeof(uint32_t) * dawg->edgeCount;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints the size of the graph and the share of it each query walked.
+ * @param dawg
+ */
+void dawgPrintStats(Dawg* dawg)
+{
+    assert(dawg != NULL);
+    double average = dawg->queries ? (double)dawg->visited / dawg->queries : 0;
+    printf("DAWG: %d words, %d nodes, %d edges, %.1f bytes per word\n", dawg->wordCount,
+           dawg->nodeCount, dawg->edgeCount - 1,
+           dawg->wordCount ? (double)dawgBytes(dawg) / dawg->wordCount : 0.0);
+    printf("DAWG: %ld queries, %.0f of %d edges walked per query\n", dawg->queries,
+           average, dawg->edgeCount - 1);
+}
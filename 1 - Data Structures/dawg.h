@@ -0,0 +1,63 @@
+#ifndef DAWG_H
+#define DAWG_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * DAWG
+ * Description: Header file for a directed acyclic word graph, a trie whose
+ *              identical subtrees are merged so words share their suffixes as
+ *              well as their prefixes. The graph is packed into one array of
+ *              32 bit edges, answers membership and prefix queries by walking
+ *              the edges, and finds suggestions by walking them with a
+ *              Levenshtein row per letter, pruning any branch the row shows
+ *              cannot come close enough.
+ *****************************************************************************/
+
+#include "hashMap.h"
+#include "suggestion.h"
+#include <stdint.h>
+
+// An edge packs its label in the low 8 bits, then these two flags, then the
+// index of the destination's first edge.
+#define DAWG_FINAL 0x100
+#define DAWG_LAST 0x200
+#define DAWG_CHILD_SHIFT 10
+// Edges are numbered from 1 so a child index of 0 means no edges follow.
+#define DAWG_MAX_EDGES (1u << (32 - DAWG_CHILD_SHIFT))
+
+typedef struct Dawg Dawg;
+
+// Called by dawgComplete with each word and the caller's argument.
+typedef void (*DawgVisit)(const char* word, void* arg);
+
+struct Dawg
+{
+    // Packed edges. Each node's edges are consecutive, the last one flagged
+    // DAWG_LAST, in ascending label order.
+    uint32_t* edges;
+    int edgeCount;
+    // First edge of the root.
+    uint32_t root;
+    int nodeCount;
+    int wordCount;
+    // Longest word, which bounds the depth of every walk.
+    int maxLength;
+    // Words returned by dawgQuery, copied on first use since the graph does
+    // not hold them as strings. Maps a word to its place in spelled.
+    HashMap* interned;
+    char** spelled;
+    int spelledCapacity;
+    // Totals over every dawgQuery, to measure how much the rows prune.
+    long queries;
+    long visited;
+};
+
+Dawg* dawgNew(const char** words, int count);
+void dawgDelete(Dawg* dawg);
+int dawgContains(Dawg* dawg, const char* word);
+int dawgComplete(Dawg* dawg, const char* prefix, int limit, DawgVisit visit, void* arg);
+int dawgQuery(Dawg* dawg, const char* word, int k, int maxDistance, Suggestion* results);
+size_t dawgBytes(Dawg* dawg);
+void dawgPrintStats(Dawg* dawg);
+
+#endif
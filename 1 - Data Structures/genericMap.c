@@ -0,0 +1,490 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Generic Hash Map
+ * Description: Robin Hood hashing over slots of caller chosen size. Each slot
+ *              is a GenericSlot header, then the key (inline, or a pointer to
+ *              an arena copy for string keys), then the value, so finding a
+ *              key and reading its value touch the same cache lines.
+ *****************************************************************************/
+
+#include "genericMap.h"
+#include "hashMap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*** IMPLEMENT ***************************************************************
+ * Rounds a size up to a multiple of 8 bytes, so keys and values placed at
+ * such offsets in a slot are aligned for any type.
+ * @param size
+ * @return The rounded size.
+ */
+static size_t align8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Compares two keys byte for byte. The default equals function.
+ * @param a
+ * @param b
+ * @param size
+ * @return Non-zero if the keys are equal.
+ */
+static int bytesEqual(const void* a, const void* b, size_t size)
+{
+    return memcmp(a, b, size) == 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the slot at index.
+ * @param map
+ * @param index
+ * @return The slot.
+ */
+static GenericSlot* slotAt(GenericMap* map, int index)
+{
+    return (GenericSlot*)(map->slots + (size_t)index * map->slotSize);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the key held by a slot, inline or in the arena.
+ * @param map
+ * @param slot
+ * @return The key's bytes.
+ */
+static const void* slotKey(GenericMap* map, GenericSlot* slot)
+{
+    const char* key = (const char*)(slot + 1);
+    return map->keySize > 0 ? key : *(const char* const*)key;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the value stored in a slot.
+ * @param map
+ * @param slot
+ * @return The value's bytes.
+ */
+static void* slotValue(GenericMap* map, GenericSlot* slot)
+{
+    return (char*)slot + map->valueOffset;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the length and hash of a key for a map. Never returns a hash of 0,
+ * the empty slot marker.
+ * @param map
+ * @param key
+ * @param length Set to the key's length.
+ * @return Non-zero hash of the key.
+ */
+static unsigned int keyHash(GenericMap* map, const void* key, size_t* length)
+{
+    *length = map->keySize > 0 ? map->keySize : strlen(key);
+    unsigned int hash = map->hash(key, *length, map->seed);
+    return hash == 0 ? 1 : hash;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Allocates capacity empty slots, rounded up to a power of two.
+ * @param map
+ * @param capacity The minimum number of slots.
+ */
+static void slotsInit(GenericMap* map, int capacity)
+{
+    int slots = 8;
+    while (slots < capacity)
+    {
+        slots *= 2;
+    }
+    map->capacity = slots;
+    map->size = 0;
+    map->slots = calloc(slots, map->slotSize);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns how many slots away from its home slot the entry at index is.
+ * @param map
+ * @param index Index of an occupied slot.
+ * @return Probe distance of the entry.
+ */
+static int slotDistance(GenericMap* map, int index)
+{
+    int mask = map->capacity - 1;
+    return (index - (int)(slotAt(map, index)->hash & mask)) & mask;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Places a filled slot into the table, displacing entries closer to their
+ * home slot as it goes. The caller guarantees the key is not already present
+ * and that there is a free slot.
+ * @param map
+ * @param entry Slot to place, which may be one of the scratch slots. Its
+ *              contents are overwritten.
+ * @return Index where the entry came to rest.
+ */
+static int slotsPlace(GenericMap* map, GenericSlot* entry)
+{
+    // Carry the entry in the first scratch slot, swapping through the second
+    char* carried = map->scratch;
+    char* swap = map->scratch + map->slotSize;
+    if ((char*)entry != carried)
+    {
+        memcpy(carried, entry, map->slotSize);
+    }
+    int mask = map->capacity - 1;
+    int index = ((GenericSlot*)carried)->hash & mask;
+    int distance = 0;
+    int placed = -1;
+
+    // Probe until an empty slot takes the entry being carried
+    while (slotAt(map, index)->hash != 0)
+    {
+        // Swap with a richer entry and carry it forward instead
+        int existing = slotDistance(map, index);
+        if (existing < distance)
+        {
+            memcpy(swap, slotAt(map, index), map->slotSize);
+            memcpy(slotAt(map, index), carried, map->slotSize);
+            memcpy(carried, swap, map->slotSize);
+            distance = existing;
+            if (placed < 0)
+            {
+                placed = index;
+            }
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+    memcpy(slotAt(map, index), carried, map->slotSize);
+    return placed < 0 ? index : placed;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Moves every entry into a new slot array with the given capacity, reusing
+ * the cached hashes. Keys and values move with their slots.
+ * @param map
+ * @param capacity The minimum number of slots.
+ */
+static void slotsResize(GenericMap* map, int capacity)
+{
+    char* old = map->slots;
+    int oldCapacity = map->capacity;
+    int size = map->size;
+
+    slotsInit(map, capacity);
+    for (int i = 0; i < oldCapacity; i++)
+    {
+        GenericSlot* slot = (GenericSlot*)(old + (size_t)i * map->slotSize);
+        if (slot->hash != 0)
+        {
+            slotsPlace(map, slot);
+        }
+    }
+    map->size = size;
+    free(old);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the index of the slot holding key, or -1 if it is not in the table.
+ * The search stops at the first entry closer to its home slot than the key
+ * would be.
+ * @param map
+ * @param key
+ * @param length Length of the key.
+ * @param hash keyHash of the key.
+ * @return Slot index or -1.
+ */
+static int slotsFind(GenericMap* map, const void* key, size_t length, unsigned int hash)
+{
+    int mask = map->capacity - 1;
+    int index = hash & mask;
+    int distance = 0;
+
+    while (slotAt(map, index)->hash != 0 && slotDistance(map, index) >= distance)
+    {
+        GenericSlot* slot = slotAt(map, index);
+        if (slot->hash == hash && slot->keyLength == length &&
+            map->equals(slotKey(map, slot), key, length))
+        {
+            return index;
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+    return -1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates an empty map. Keys are hashed with hashWyBytes and compared with
+ * memcmp until genericMapSetHash says otherwise.
+ * @param keySize Bytes of each key, or 0 for null terminated string keys.
+ * @param valueSize Bytes of each value, stored inline. May be 0 for a set.
+ * @param capacity The number of slots to start with.
+ * @return The allocated map.
+ */
+GenericMap* genericMapNew(size_t keySize, size_t valueSize, int capacity)
+{
+    GenericMap* map = malloc(sizeof(GenericMap));
+    map->keySize = keySize;
+    map->valueSize = valueSize;
+    map->valueOffset = align8(sizeof(GenericSlot) + (keySize > 0 ? keySize : sizeof(char*)));
+    map->slotSize = align8(map->valueOffset + valueSize);
+    map->hash = hashWyBytes;
+    map->equals = bytesEqual;
+    map->seed = 0;
+    map->arena = keySize == 0 ? arenaNew(ARENA_BLOCK_SIZE) : NULL;
+    map->scratch = malloc(2 * map->slotSize);
+    slotsInit(map, capacity);
+    return map;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the map, its slots and its copies of string keys. Anything the values
+ * point to is the caller's to free first, see genericMapNext.
+ * @param map
+ */
+void genericMapDelete(GenericMap* map)
+{
+    assert(map != NULL);
+    if (map->arena != NULL)
+    {
+        arenaDelete(map->arena);
+    }
+    free(map->scratch);
+    free(map->slots);
+    free(map);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Changes how keys are hashed and compared. Entries already in the map are
+ * rehashed into place.
+ * @param map
+ * @param hash Hash function, or NULL for hashWyBytes.
+ * @param equals Equality function, or NULL for memcmp.
+ * @param seed Seed passed to every call of hash.
+ */
+void genericMapSetHash(GenericMap* map, GenericHash hash, GenericEquals equals,
+                       unsigned int seed)
+{
+    assert(map != NULL);
+    map->hash = hash != NULL ? hash : hashWyBytes;
+    map->equals = equals != NULL ? equals : bytesEqual;
+    map->seed = seed;
+    if (map->size == 0)
+    {
+        return;
+    }
+
+    // Refresh the cached hashes, then place every slot again
+    for (int i = 0; i < map->capacity; i++)
+    {
+        GenericSlot* slot = slotAt(map, i);
+        if (slot->hash != 0)
+        {
+            unsigned int rehash = map->hash(slotKey(map, slot), slot->keyLength, seed);
+            slot->hash = rehash == 0 ? 1 : rehash;
+        }
+    }
+    slotsResize(map, map->capacity);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a pointer to the value stored for key, or NULL if key is not in the
+ * map. The pointer stays valid until the next put, add or remove.
+ * @param map
+ * @param key
+ * @return The value or NULL.
+ */
+void* genericMapGet(GenericMap* map, const void* key)
+{
+    assert(map != NULL && key != NULL);
+    size_t length;
+    unsigned int hash = keyHash(map, key, &length);
+    int index = slotsFind(map, key, length, hash);
+    return index < 0 ? NULL : slotValue(map, slotAt(map, index));
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the value stored for key, adding key with a zeroed value first if it
+ * is not in the map. One search serves both the lookup and the insert, so
+ * callers that fill in a value on a miss never search twice.
+ * @param map
+ * @param key Copied into the map if added.
+ * @param added If not NULL, set to 1 if key was added and 0 if found.
+ * @return The value, valid until the next put, add or remove.
+ */
+void* genericMapFindOrAdd(GenericMap* map, const void* key, int* added)
+{
+    assert(map != NULL && key != NULL);
+    size_t length;
+    unsigned int hash = keyHash(map, key, &length);
+    int index = slotsFind(map, key, length, hash);
+    if (added != NULL)
+    {
+        *added = index < 0;
+    }
+    if (index >= 0)
+    {
+        return slotValue(map, slotAt(map, index));
+    }
+
+    // Grow before the new entry would push the load past the maximum
+    if (map->size + 1 > map->capacity * MAX_OPEN_TABLE_LOAD)
+    {
+        slotsResize(map, 2 * map->capacity);
+    }
+
+    // Build the entry in scratch, copying a string key into the arena
+    GenericSlot* entry = (GenericSlot*)map->scratch;
+    memset(entry, 0, map->slotSize);
+    entry->hash = hash;
+    entry->keyLength = length;
+    if (map->keySize > 0)
+    {
+        memcpy(entry + 1, key, length);
+    }
+    else
+    {
+        char* copy = arenaAlloc(map->arena, length + 1);
+        memcpy(copy, key, length + 1);
+        memcpy(entry + 1, &copy, sizeof(char*));
+    }
+    index = slotsPlace(map, entry);
+    map->size++;
+    return slotValue(map, slotAt(map, index));
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Stores a copy of value for key, replacing any value already stored.
+ * @param map
+ * @param key
+ * @param value valueSize bytes to copy, or NULL to store zeros.
+ * @return The stored value, valid until the next put, add or remove.
+ */
+void* genericMapPut(GenericMap* map, const void* key, const void* value)
+{
+    void* stored = genericMapFindOrAdd(map, key, NULL);
+    if (value != NULL)
+    {
+        memcpy(stored, value, map->valueSize);
+    }
+    else
+    {
+        memset(stored, 0, map->valueSize);
+    }
+    return stored;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Removes key and its value from the map. Entries after it are shifted back
+ * a slot until one is found in its home slot, so no tombstones are needed.
+ * @param map
+ * @param key
+ * @return 1 if key was removed, 0 if it was not in the map.
+ */
+int genericMapRemove(GenericMap* map, const void* key)
+{
+    assert(map != NULL && key != NULL);
+    size_t length;
+    unsigned int hash = keyHash(map, key, &length);
+    int index = slotsFind(map, key, length, hash);
+    if (index < 0)
+    {
+        return 0;
+    }
+    if (map->keySize == 0)
+    {
+        arenaFree(map->arena, (void*)slotKey(map, slotAt(map, index)), length + 1);
+    }
+
+    // Shift displaced entries back into the hole
+    int mask = map->capacity - 1;
+    int next = (index + 1) & mask;
+    while (slotAt(map, next)->hash != 0 && slotDistance(map, next) > 0)
+    {
+        memcpy(slotAt(map, index), slotAt(map, next), map->slotSize);
+        index = next;
+        next = (next + 1) & mask;
+    }
+    slotAt(map, index)->hash = 0;
+    map->size--;
+    return 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of keys in the map.
+ * @param map
+ * @return Number of keys.
+ */
+int genericMapSize(GenericMap* map)
+{
+    assert(map != NULL);
+    return map->size;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Steps through the entries of the map in slot order:
+ *     for (int i = genericMapNext(map, -1, &key, &value); i >= 0;
+ *          i = genericMapNext(map, i, &key, &value))
+ * The map must not be changed during the walk.
+ * @param map
+ * @param position -1 to start, or the position last returned.
+ * @param key If not NULL, set to the entry's key.
+ * @param value If not NULL, set to the entry's value.
+ * @return Position of the next entry, or -1 when there are no more.
+ */
+int genericMapNext(GenericMap* map, int position, const void** key, void** value)
+{
+    assert(map != NULL);
+    for (int i = position + 1; i < map->capacity; i++)
+    {
+        GenericSlot* slot = slotAt(map, i);
+        if (slot->hash != 0)
+        {
+            if (key != NULL)
+            {
+                *key = slotKey(map, slot);
+            }
+            if (value != NULL)
+            {
+                *value = slotValue(map, slot);
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes of memory the map holds: its slots plus the arena of
+ * string keys.
+ * @param map
+ * @return Bytes held by the map.
+ */
+size_t genericMapBytes(GenericMap* map)
+{
+    assert(map != NULL);
+    size_t bytes = (size_t)map->capacity * map->slotSize + 2 * map->slotSize;
+    return map->arena != NULL ? bytes + map->arena->bytes : bytes;
+}
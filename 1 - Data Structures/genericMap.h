@@ -0,0 +1,72 @@
+#ifndef GENERIC_MAP_H
+#define GENERIC_MAP_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Generic Hash Map
+ * Description: Header file for a hash map with keys and values of any type.
+ *              Keys are fixed size byte strings or null terminated strings,
+ *              and values of any fixed size are stored inside the table's
+ *              slots, so a lookup lands on its payload without following a
+ *              pointer. Slots are probed linearly using Robin Hood hashing,
+ *              like the open layout of the Hash Map, which remains the
+ *              string key, int value specialization.
+ *****************************************************************************/
+
+#include "arena.h"
+#include <stddef.h>
+
+typedef struct GenericMap GenericMap;
+typedef struct GenericSlot GenericSlot;
+
+// Hashes a key of size bytes. Strings are passed without their terminator.
+typedef unsigned int (*GenericHash)(const void* key, size_t size, unsigned int seed);
+// Returns non-zero if two keys of size bytes are equal. Only called on keys
+// whose hashes and sizes already match.
+typedef int (*GenericEquals)(const void* a, const void* b, size_t size);
+
+// Header of every slot. The key, then the value, follow it in the slot.
+struct GenericSlot
+{
+    // Cached hash of the key. 0 marks an empty slot.
+    unsigned int hash;
+    // Length of a string key without its terminator, or the key size.
+    unsigned int keyLength;
+};
+
+struct GenericMap
+{
+    // Bytes of each key, or 0 for null terminated string keys, which are
+    // copied into arena and referenced from their slots.
+    size_t keySize;
+    // Bytes of each value, stored inline.
+    size_t valueSize;
+    // Bytes of each slot, and where its value starts.
+    size_t slotSize;
+    size_t valueOffset;
+    // capacity slots of slotSize bytes, a power of two.
+    char* slots;
+    int capacity;
+    int size;
+    GenericHash hash;
+    GenericEquals equals;
+    unsigned int seed;
+    // Copies of string keys, or NULL for fixed size keys.
+    Arena* arena;
+    // Room for two slots, used while entries are displaced.
+    char* scratch;
+};
+
+GenericMap* genericMapNew(size_t keySize, size_t valueSize, int capacity);
+void genericMapDelete(GenericMap* map);
+void genericMapSetHash(GenericMap* map, GenericHash hash, GenericEquals equals,
+                       unsigned int seed);
+void* genericMapGet(GenericMap* map, const void* key);
+void* genericMapPut(GenericMap* map, const void* key, const void* value);
+void* genericMapFindOrAdd(GenericMap* map, const void* key, int* added);
+int genericMapRemove(GenericMap* map, const void* key);
+int genericMapSize(GenericMap* map);
+int genericMapNext(GenericMap* map, int position, const void** key, void** value);
+size_t genericMapBytes(GenericMap* map);
+
+#endif
@@ -9,16 +9,30 @@
  *****************************************************************************/
 
 #include "hashMap.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// SSE2 and AVX2 key comparisons, chosen at run time by chooseKeyCompare
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HASH_MAP_X86 1
+#include <immintrin.h>
+#endif
 
 /*** HELPER CODE *************************************************************/
-int hashFunction1(const char* key)
+unsigned int hashFunction1(const char* key, unsigned int seed)
 {
-    int r = 0;
+    unsigned int r = 0;
     for (int i = 0; key[i] != '\0'; i++)
     {
         r += key[i];
@@ -28,9 +42,9 @@ int hashFunction1(const char* key)
 
 
 /*** HELPER CODE *************************************************************/
-int hashFunction2(const char* key)
+unsigned int hashFunction2(const char* key, unsigned int seed)
 {
-    int r = 0;
+    unsigned int r = 0;
     for (int i = 0; key[i] != '\0'; i++)
     {
         r += (i + 1) * key[i];
@@ -39,450 +53,2542 @@ int hashFunction2(const char* key)
 }
 
 
-/*** HELPER CODE *************************************************************
- * Creates a new hash table link with a copy of the key string.
- * @param key Key string to copy in the link.
- * @param value Value to set in the link.
- * @param next Pointer to set as the link's next.
- * @return Hash table link allocated on the heap.
+/*** IMPLEMENT ***************************************************************
+ * 32-bit FNV-1a hash. Mixes every byte into the whole word, so anagrams and
+ * short keys spread across the table. The seed is folded into the offset
+ * basis.
+ * @param key
+ * @param seed
+ * @return Hash of the key.
  */
-HashLink* hashLinkNew(const char* key, int value, HashLink* next)
+unsigned int hashFnv1a(const char* key, unsigned int seed)
 {
-    HashLink* link = malloc(sizeof(HashLink));
-    link->key = malloc(sizeof(char) * (strlen(key) + 1));
-    strcpy(link->key, key);
-    link->value = value;
-    link->next = next;
-    return link;
+    unsigned int r = 2166136261u ^ seed;
+    for (int i = 0; key[i] != '\0'; i++)
+    {
+        r ^= (unsigned char)key[i];
+        r *= 16777619u;
+    }
+    return r;
 }
 
 
-/*** HELPER CODE *************************************************************
- * Initializes a hash table map, allocating memory for a link pointer table with
- * the given number of buckets.
- * @param map
- * @param capacity The number of table buckets.
+/*** IMPLEMENT ***************************************************************
+ * Multiplies two 64-bit words into 128 bits and folds the halves together.
+ * @param a
+ * @param b
+ * @return Mixed word.
  */
-void hashMapInit(HashMap* map, int capacity)
+static uint64_t wyMix(uint64_t a, uint64_t b)
 {
-    map->capacity = capacity;
-    map->size = 0;
-    map->table = malloc(sizeof(HashLink*) * capacity);
-    for (int i = 0; i < capacity; i++)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Reads up to 8 bytes of a key as a little-endian word, padding with zeros.
+ * @param p
+ * @param n Number of bytes to read.
+ * @return The bytes as a word.
+ */
+static uint64_t wyRead(const unsigned char* p, size_t n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // A whole word is one load on a little-endian machine
+    if (n == 8)
     {
-        map->table[i] = NULL;
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+#endif
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        v |= (uint64_t)p[i] << (8 * i);
     }
+    return v;
 }
 
 
-/*** HELPER CODE *************************************************************
- * Creates a hash table map, allocating memory for a link pointer table with
- * the given number of buckets.
- * @param capacity The number of buckets.
- * @return The allocated map.
+/*** IMPLEMENT ***************************************************************
+ * hashWy of length bytes, which may include nulls. Hashes keys whose length
+ * is already known, and keys that are not strings.
+ * @param key
+ * @param length Number of bytes to hash.
+ * @param seed
+ * @return Hash of the bytes.
  */
-HashMap* hashMapNew(int capacity)
+unsigned int hashWyBytes(const void* key, size_t length, unsigned int seed)
 {
-    HashMap* map = malloc(sizeof(HashMap));
-    hashMapInit(map, capacity);
-    return map;
+    const uint64_t p0 = 0xa0761d6478bd642full;
+    const uint64_t p1 = 0xe7037ed1a0b428dbull;
+    const uint64_t p2 = 0x8ebc6af09c88c6e3ull;
+    const unsigned char* p = (const unsigned char*)key;
+    size_t left = length;
+    uint64_t s = seed ^ p0;
+
+    // Mix whole 16 byte blocks
+    while (left > 16)
+    {
+        s = wyMix(wyRead(p, 8) ^ p1, wyRead(p + 8, 8) ^ s);
+        p += 16;
+        left -= 16;
+    }
+
+    // Mix the remaining 0 to 16 bytes
+    uint64_t a = wyRead(p, left < 8 ? left : 8);
+    uint64_t b = left > 8 ? wyRead(p + 8, left - 8) : 0;
+    return (unsigned int)wyMix(p1 ^ length, wyMix(a ^ p1, b ^ s ^ p2));
 }
 
 
-/*** HELPER CODE *************************************************************
- * Free the allocated memory for a hash table link created with hashLinkNew.
- * @param link
+/*** IMPLEMENT ***************************************************************
+ * wyhash-style hash. Consumes the key 16 bytes at a time through 64x64-bit
+ * multiplies, which is far cheaper per byte than FNV-1a on long keys. Every
+ * step mixes in the seed, so a map seeded with hashSeedRandom cannot be
+ * flooded with keys precomputed to collide.
+ * @param key
+ * @param seed
+ * @return Hash of the key.
  */
-static void hashLinkDelete(HashLink* link)
+unsigned int hashWy(const char* key, unsigned int seed)
 {
-    free(link->key);
-    free(link);
+    return hashWyBytes(key, strlen(key), seed);
 }
 
 
 /*** IMPLEMENT ***************************************************************
- * Removes all links in the map and frees all allocated memory. You can use
- * hashLinkDelete to free the links.
- * @param maps
+ * Returns a seed for hashWy or hashFnv1a that differs between runs, taken
+ * from /dev/urandom or the clock if that is unavailable.
+ * @return Random seed.
  */
-void hashMapCleanUp(HashMap* map)
+unsigned int hashSeedRandom()
 {
-    assert(map != NULL);
-
-    // Loop over each bucket to delete all HashLinks
-    int i;
-    for(i = 0; i < map->capacity; i++)
+    unsigned int seed = 0;
+    FILE* random = fopen("/dev/urandom", "rb");
+    if (random == NULL || fread(&seed, sizeof(seed), 1, random) != 1)
     {
-        // Create helper HashLink ptr and assign to first link in bucket
-        HashLink* garbage = map->table[i];
-            
-        // Traverse bucket to delete all HashLinks
-        while(garbage != NULL)
-        {
-            // Assign first bucket HashLink to next link
-            map->table[i] = garbage->next;
-                
-            // Delete garbage HashLink and assign garbage to bucket start
-            hashLinkDelete(garbage);
-            garbage = map->table[i];
-            
-            // Decrement size
-            map->size--;
-        }
+        seed = (unsigned int)time(NULL) ^ (unsigned int)clock();
     }
-    //Free memory allocated for table
-    free(map->table);
+    if (random != NULL)
+    {
+        fclose(random);
+    }
+    return seed;
 }
 
 
-/*** HELPER CODE *************************************************************
- * Removes all links in the map and frees all allocated memory, including the
- * map itself.
- * @param map
+/*** IMPLEMENT ***************************************************************
+ * Compares two keys of the same length with memcmp.
+ * @param a
+ * @param b
+ * @param length Length of both keys.
+ * @return 1 if the keys are equal, 0 otherwise.
  */
-void hashMapDelete(HashMap* map)
+static int keyBytesEqualScalar(const char* a, const char* b, size_t length)
 {
-    hashMapCleanUp(map);
-    free(map);
+    return memcmp(a, b, length) == 0;
 }
 
+#ifdef HASH_MAP_X86
 /*** IMPLEMENT ***************************************************************
- * Returns a pointer to the value of the link with the given key and skip 
- * traversing as well. Returns NULL if no link with that key is in the table.
- * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
- * correct linked list bucket. Also make sure to search the entire list.
- * 
- * @param map
- * @param key
- * @return Link value or NULL if no matching link.
+ * Compares two keys of the same length 16 bytes at a time with SSE2. The
+ * last block overlaps the one before it rather than looping over a tail.
+ * @param a
+ * @param b
+ * @param length Length of both keys, at least 16.
+ * @return 1 if the keys are equal, 0 otherwise.
  */
-int* hashMapGet(HashMap* map, const char* key)
+__attribute__((target("sse2")))
+static int keyBytesEqualSse2(const char* a, const char* b, size_t length)
 {
-    assert(map != NULL); 
-    assert(key != NULL);
-    
-    // Get index for the given key
-    int index = HASH_FUNCTION(key) % map->capacity;
-    
-    // Create helper HashLink ptr and assign to first link of bucket
-    HashLink* curLink = map->table[index];
-    
-    // Traverse bucket  until curLink is NULL
-    while(curLink != NULL)
+    for (size_t i = 0; ; i += 16)
     {
-        // If curLink's key matches given key...
-        if(strcmp(curLink->key, key) == 0)
+        if (i + 16 > length)
         {
-            // Return reference to the value
-            return &(curLink->value);
+            i = length - 16;
         }
-        // Else, assign curLink to next HashLink
-        else
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
         {
-            curLink = curLink->next;
+            return 0;
+        }
+        if (i + 16 == length)
+        {
+            return 1;
         }
     }
-    // If key is not found, return NULL
-    return NULL;
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Resizes the hash table to have a number of buckets equal to the given 
- * capacity (double of the old capacity). After allocating the new table, 
- * all of the links need to rehashed into it because the capacity has changed.
- * 
- * Remember to free the old table and any old links if you use hashMapPut to
- * rehash them.
- * 
- * @param map
- * @param capacity The new number of buckets.
+ * Compares two keys of the same length 32 bytes at a time with AVX2, leaving
+ * keys shorter than 32 bytes to SSE2.
+ * @param a
+ * @param b
+ * @param length Length of both keys, at least 16.
+ * @return 1 if the keys are equal, 0 otherwise.
  */
-void resizeTable(HashMap* map, int capacity)
+__attribute__((target("avx2")))
+static int keyBytesEqualAvx2(const char* a, const char* b, size_t length)
 {
-    // FIXME: implement
-    assert(map != NULL);
-    
-    // Create temp table to hold original values
-    HashMap* tempMap = malloc(sizeof(HashMap));
-    tempMap->table = map->table;
-    tempMap->capacity = map->capacity;
-    tempMap->size = map->size;
-
-    // Initialize originally allocated hash map with new size
-    hashMapInit(map, capacity);
-
-    // Loop over each bucket of the temp map
-    int i;
-    for(i = 0; i < tempMap->capacity; i++)
+    if (length < 32)
     {
-        // Create helper HashLink ptr and assign to first link of bucket
-        HashLink* curLink = tempMap->table[i];
-
-        // Traverse the HashLinks in the bucket until NULL...
-        while(curLink != NULL)
+        return keyBytesEqualSse2(a, b, length);
+    }
+    for (size_t i = 0; ; i += 32)
+    {
+        if (i + 32 > length)
         {
-            // Put HashLink in the new map and assign helper to the next link
-            hashMapPut(map, curLink->key, curLink->value);
-            curLink = curLink->next;
+            i = length - 32;
+        }
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFFu)
+        {
+            return 0;
+        }
+        if (i + 32 == length)
+        {
+            return 1;
         }
     }
-    // Free links, table, and HashMap associated with tempMap
-    hashMapDelete(tempMap);
 }
+#endif
+
+// Comparison for keys of HASH_KEY_SIMD_LENGTH bytes or more, set by
+// chooseKeyCompare.
+static int (*keyBytesEqualLong)(const char* a, const char* b, size_t length);
 
 /*** IMPLEMENT ***************************************************************
- * Updates the given key-value pair in the hash table. If a link with the given
- * key already exists, this will just update the value and skip traversing. Otherwise, it will
- * create a new link with the given key and value and add it to the table
- * bucket's linked list. You can use hashLinkNew to create the link.
- * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
- * correct linked list bucket.
- * 
- * @param map
- * @param key
- * @param value
+ * Picks the widest key comparison the processor supports, once. Called when
+ * a map is created, before any key is compared.
  */
-void hashMapPut(HashMap* map, const char* key, int value)
+static void chooseKeyCompare()
 {
-    assert(map != NULL);
-    assert(key != NULL);
-
-    // If table load exceeds maximum, double table size
-    if(hashMapTableLoad(map) >= MAX_TABLE_LOAD)
+    if (keyBytesEqualLong != NULL)
     {
-        resizeTable(map, 2 * hashMapCapacity(map));
+        return;
     }
-
-    // Get index for the given key
-    int index = HASH_FUNCTION(key) % map->capacity;
-
-    // Create helper HashLink and assign to first link in bucket
-    HashLink* curLink = map->table[index];
-
-    // If curLink is NULL, add new value as first link in bucket
-    if(curLink == NULL)
+#ifdef HASH_MAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
     {
-        map->table[index] = hashLinkNew(key, value, NULL);
-        map->size++;
+        keyBytesEqualLong = keyBytesEqualAvx2;
+        return;
     }
-    // Else, traverse the bucket's chain to get location to put key value pair
-    else
+    if (__builtin_cpu_supports("sse2"))
     {
-        // Create loop control
-        int put = 0;    
-
-        // Traverse bucket until the key value pair is put into HashMap
-        while(put == 0)
-        {
-            // If curLink's key equals the given key, replace the value
-            if(strcmp(curLink->key, key) == 0)
-            {
-                curLink->value = value;
-                put = 1;  // Change flag value to true
-            }
-            // If curLink's next ptr is NULL, create new link at curLink's next
-            else if(curLink->next == NULL)
-            {
-                curLink->next = hashLinkNew(key, value, NULL);
-                map->size++;
-                put = 1;  // Change flag value to true
-            }
-            // Else, traverse to next link in bucket
-            else
-            {
-                curLink = curLink->next;
-            }
-        }   
+        keyBytesEqualLong = keyBytesEqualSse2;
+        return;
     }
+#endif
+    keyBytesEqualLong = keyBytesEqualScalar;
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Removes and frees the link with the given key from the table. If no such link
- * exists, this does nothing. Remember to search the entire linked list at the
- * bucket. You can use hashLinkDelete to free the link.
- * @param map
+ * Returns whether a stored key equals a key being searched for. The caller
+ * has already matched the cached hash and length, so only the bytes are left.
+ * @param stored
  * @param key
+ * @param length Length of both keys.
+ * @return 1 if the keys are equal, 0 otherwise.
  */
-void hashMapRemove(HashMap* map, const char* key)
+static int keysEqual(const char* stored, const char* key, int length)
 {
-    assert(map != NULL);
-    assert(key != NULL);
-    
-    // Get index for the given key
-    int index = HASH_FUNCTION(key) % map->capacity;
-
-    // Create helper HashLink ptr to hold current link
-    HashLink* curLink = map->table[index];
-    
-    // If curLink is not NULL and its key matches the given key...
-    if(curLink != NULL && (strcmp(curLink->key, key) == 0))
+    if (length < HASH_KEY_SIMD_LENGTH)
     {
-        // Assign first link in bucket to next, delete curLink, & decrement map size
-        map->table[index] = curLink->next;
-        hashLinkDelete(curLink);
-        map->size--;
+        return memcmp(stored, key, length) == 0;
     }
-    // If curLink is not NULL...
-    else if(curLink != NULL)
-    {
-        // Create helper HashLink ptr to hold previous link & assign curLink to next
-        HashLink* prev = curLink;
-        curLink = curLink->next;
-        int rmvFlag = 0;  // Flag indicating removal
-        
-        // Traverse bucket until curLink is NULL or HashLink removed
-        while(curLink != NULL && !rmvFlag)
-        {
-            // If curLink's key matches given key...
-            if(strcmp(curLink->key, key) == 0)
-            {
-                // Assign prev's next to curLink's next & delete curLink
-                prev->next = curLink->next;
-                hashLinkDelete(curLink);
+    return keyBytesEqualLong(stored, key, length);
+}
 
-                // Decrement size and set remove flag
-                map->size--;
-                rmvFlag = 1;
-            }
-            //If key does not match curLink's key...
-            else
-            {
-                // Assign curLink to prev and curLink to curLink's next
-                prev = curLink;
-                curLink = curLink->next;
-            }
-        }
+
+/*** IMPLEMENT ***************************************************************
+ * Hashes a key with the map's hash function and seed. hashWy is given the
+ * length the caller already measured instead of measuring it again.
+ * @param map
+ * @param key
+ * @param length strlen(key)
+ * @return Hash of the key.
+ */
+static unsigned int keyHash(HashMap* map, const char* key, int length)
+{
+    if (map->hash == hashWy)
+    {
+        return hashWyBytes(key, length, map->seed);
     }
+    return map->hash(key, map->seed);
 }
 
 
 /*** IMPLEMENT ***************************************************************
- * Returns 1 if a link with the given key is in the table and 0 otherwise.
- * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
- * correct linked list bucket. Also make sure to search the entire list.
- * 
+ * Hashes a key for an open map. Never returns 0, the empty slot marker.
  * @param map
  * @param key
- * @return 1 if the key is found, 0 otherwise.
+ * @param length strlen(key)
+ * @return Non-zero hash of the key.
+ */
+static unsigned int slotHash(HashMap* map, const char* key, int length)
+{
+    unsigned int hash = keyHash(map, key, length);
+    return hash == 0 ? 1 : hash;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Adds a search's length to the map's statistics, if it keeps them.
+ * @param map
+ * @param probes Key comparisons or slots examined by the search.
+ */
+static void countProbes(HashMap* map, int probes)
+{
+    if (map->stats != NULL)
+    {
+        map->stats->probes += probes;
+        if (probes > map->stats->longestProbe)
+        {
+            map->stats->longestProbe = probes;
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Counts a lookup in the map's statistics, if it keeps them.
+ * @param map
+ * @param found Whether the key was in the map.
+ */
+static void countLookup(HashMap* map, int found)
+{
+    if (map->stats != NULL)
+    {
+        map->stats->lookups++;
+        map->stats->hits += found;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Counts puts and removes in the map's statistics, if it keeps them.
+ * @param map
+ * @param puts Keys put.
+ * @param removes Keys asked to be removed.
+ * @param grown How much the put or remove changed the map's size.
+ */
+static void countUpdate(HashMap* map, int puts, int removes, int grown)
+{
+    if (map->stats != NULL)
+    {
+        map->stats->puts += puts;
+        map->stats->inserts += grown > 0 ? grown : 0;
+        map->stats->removes += removes;
+        map->stats->removed += grown < 0 ? -grown : 0;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Counts a link or key allocation in the map's statistics, if it keeps them.
+ * @param map
+ * @param size Bytes allocated.
+ */
+static void countAllocation(HashMap* map, size_t size)
+{
+    if (map->stats != NULL)
+    {
+        map->stats->allocations++;
+        map->stats->allocatedBytes += size;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Counts a finished resize in the map's statistics, if it keeps them.
+ * @param map
+ * @param start clock() when the resize began.
+ */
+static void countResize(HashMap* map, clock_t start)
+{
+    if (map->stats != NULL)
+    {
+        map->stats->resizes++;
+        map->stats->resizeSeconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Allocates memory for a link or key from the map's arena, or from the heap
+ * if the map does not use one.
+ * @param map
+ * @param size
+ * @return Allocated memory.
+ */
+static void* mapAlloc(HashMap* map, size_t size)
+{
+    countAllocation(map, size);
+    return map->arena != NULL ? arenaAlloc(map->arena, size) : malloc(size);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Releases memory allocated with mapAlloc.
+ * @param map
+ * @param ptr
+ * @param size The size ptr was allocated with.
+ */
+static void mapFree(HashMap* map, void* ptr, size_t size)
+{
+    if (map->arena != NULL)
+    {
+        arenaFree(map->arena, ptr, size);
+    }
+    else
+    {
+        free(ptr);
+    }
+}
+
+
+/*** HELPER CODE *************************************************************
+ * Creates a new hash table link with a copy of the key string.
+ * @param key Key string to copy in the link.
+ * @param value Value to set in the link.
+ * @param next Pointer to set as the link's next.
+ * @return Hash table link allocated on the heap.
+ */
+HashLink* hashLinkNew(const char* key, int value, HashLink* next)
+{
+    HashLink* link = malloc(sizeof(HashLink));
+    link->key = malloc(sizeof(char) * (strlen(key) + 1));
+    strcpy(link->key, key);
+    link->value = value;
+    link->next = next;
+    return link;
+}
+
+
+/*** HELPER CODE *************************************************************
+ * Initializes a hash table map, allocating memory for a link pointer table with
+ * the given number of buckets.
+ * @param map
+ * @param capacity The number of table buckets.
+ */
+void hashMapInit(HashMap* map, int capacity)
+{
+    map->layout = HASH_MAP_CHAINED;
+    map->slots = NULL;
+    map->snapshot = NULL;
+    map->oldTable = NULL;
+    map->oldCapacity = 0;
+    map->migrated = 0;
+    map->capacity = capacity;
+    map->size = 0;
+    map->table = malloc(sizeof(HashLink*) * capacity);
+    for (int i = 0; i < capacity; i++)
+    {
+        map->table[i] = NULL;
+    }
+}
+
+
+/*** HELPER CODE *************************************************************
+ * Creates a hash table map, allocating memory for a link pointer table with
+ * the given number of buckets.
+ * @param capacity The number of buckets.
+ * @return The allocated map.
+ */
+HashMap* hashMapNew(int capacity)
+{
+    chooseKeyCompare();
+    HashMap* map = malloc(sizeof(HashMap));
+    hashMapInit(map, capacity);
+    map->hash = HASH_FUNCTION;
+    map->seed = 0;
+    map->arena = NULL;
+    map->resizeStep = 0;
+    map->version = 0;
+    map->stats = NULL;
+    return map;
+}
+
+
+void resizeTable(HashMap* map, int capacity);
+static HashLink** chainBucket(HashMap* map, unsigned int hash);
+static void migrateBuckets(HashMap* map, int count);
+static void beginResize(HashMap* map, int capacity);
+static int mappedFind(HashMap* map, const char* key, int length);
+static int mappedBucketSize(HashMap* map, int bucket);
+static void mappedCleanUp(HashMap* map);
+
+
+/*** SNAPSHOTS ***************************************************************
+ * A snapshot is a read-only image of a map that can be mapped straight into
+ * memory. All positions are offsets from the start of the file, so the image
+ * works wherever it is mapped and every process mapping it shares the same
+ * page cache copy. The file holds, in order:
+ *   SnapshotHeader
+ *   bucketCount + 1 offsets into the entries; bucket b owns the entries from
+ *       buckets[b] up to buckets[b + 1]
+ *   SnapshotEntry for every key, grouped by bucket
+ *   every key, null terminated, packed back to back
+ * Keys are placed with hashFnv1a and the seed stored in the header.
+ *****************************************************************************/
+
+#define SNAPSHOT_MAGIC "HMSNAP1"
+
+typedef struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t seed;
+    // Power of two number of buckets.
+    uint32_t bucketCount;
+    uint32_t entryCount;
+    uint32_t keyBytes;
+    uint64_t bucketsOffset;
+    uint64_t entriesOffset;
+    uint64_t keysOffset;
+    uint64_t fileSize;
+} SnapshotHeader;
+
+typedef struct SnapshotEntry
+{
+    uint32_t hash;
+    int32_t value;
+    // Offset of the key from the start of the key blob.
+    uint32_t keyOffset;
+    uint32_t keyLength;
+} SnapshotEntry;
+
+struct HashSnapshot
+{
+    // The whole mapped file.
+    void* image;
+    size_t imageSize;
+    const uint32_t* buckets;
+    SnapshotEntry* entries;
+    const char* keys;
+};
+
+
+
+/*** OPEN ADDRESSING *********************************************************
+ * HASH_MAP_OPEN maps keep every entry in one flat array of HashSlots. Each
+ * slot caches the key's hash so probes can skip mismatches without touching
+ * the key bytes, and short keys live inside the slot itself. Collisions are
+ * resolved with linear probing using Robin Hood ordering: an entry that has
+ * probed further from its home slot takes the place of one that has probed
+ * less, which keeps probe sequences short and lets misses stop early.
+ *****************************************************************************/
+
+/*** IMPLEMENT ***************************************************************
+ * Initializes an open addressing map with the given number of slots rounded
+ * up to a power of two, so a slot index is the hash masked by capacity - 1.
+ * @param map
+ * @param capacity The minimum number of slots.
+ */
+static void openMapInit(HashMap* map, int capacity)
+{
+    int slots = 8;
+    while (slots < capacity)
+    {
+        slots *= 2;
+    }
+    map->layout = HASH_MAP_OPEN;
+    map->table = NULL;
+    map->snapshot = NULL;
+    map->oldTable = NULL;
+    map->capacity = slots;
+    map->size = 0;
+    map->slots = calloc(slots, sizeof(HashSlot));
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the key stored in a slot, inline or on the heap.
+ * @param slot
+ * @return Null terminated key.
+ */
+static const char* slotKey(const HashSlot* slot)
+{
+    return slot->keyLength < HASH_SLOT_INLINE ? slot->key.bytes : slot->key.ptr;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns how many slots away from its home slot the entry at index is.
+ * @param map
+ * @param index Index of an occupied slot.
+ * @return Probe distance of the entry.
+ */
+static int slotDistance(HashMap* map, int index)
+{
+    int mask = map->capacity - 1;
+    return (index - (int)(map->slots[index].hash & mask)) & mask;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Places a filled slot into the table, displacing entries closer to their
+ * home slot as it goes. The caller guarantees the key is not already present
+ * and that there is a free slot.
+ * @param map
+ * @param entry Slot to place. Ownership of its key moves to the table.
+ * @return Index where the entry came to rest.
+ */
+static int openMapPlace(HashMap* map, HashSlot entry)
+{
+    int mask = map->capacity - 1;
+    int index = entry.hash & mask;
+    int distance = 0;
+    int placed = -1;
+
+    // Probe until an empty slot takes the entry being carried
+    while (map->slots[index].hash != 0)
+    {
+        // Swap with a richer entry and carry it forward instead
+        int existing = slotDistance(map, index);
+        if (existing < distance)
+        {
+            HashSlot carried = map->slots[index];
+            map->slots[index] = entry;
+            entry = carried;
+            distance = existing;
+            if (placed < 0)
+            {
+                placed = index;
+            }
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+    map->slots[index] = entry;
+    return placed < 0 ? index : placed;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Moves every entry into a new slot array with the given capacity. Cached
+ * hashes are reused and keys are moved with their slots, so no key is hashed,
+ * copied, or allocated again.
+ * @param map
+ * @param capacity The minimum number of slots.
+ */
+static void openMapResize(HashMap* map, int capacity)
+{
+    clock_t start = clock();
+    HashSlot* old = map->slots;
+    int oldCapacity = map->capacity;
+    int size = map->size;
+
+    openMapInit(map, capacity);
+    for (int i = 0; i < oldCapacity; i++)
+    {
+        if (old[i].hash != 0)
+        {
+            openMapPlace(map, old[i]);
+        }
+    }
+    map->size = size;
+    free(old);
+    countResize(map, start);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the index of the slot holding key, or -1 if it is not in the table.
+ * Robin Hood ordering lets the search stop at the first entry that is closer
+ * to its home slot than the key would be.
+ * @param map
+ * @param key
+ * @param length strlen(key)
+ * @param hash slotHash(map, key, length)
+ * @return Slot index or -1.
+ */
+static int openMapFind(HashMap* map, const char* key, int length, unsigned int hash)
+{
+    int mask = map->capacity - 1;
+    int index = hash & mask;
+    int distance = 0;
+
+    while (map->slots[index].hash != 0 && slotDistance(map, index) >= distance)
+    {
+        if (map->slots[index].hash == hash && map->slots[index].keyLength == length &&
+            keysEqual(slotKey(&map->slots[index]), key, length))
+        {
+            countProbes(map, distance + 1);
+            return index;
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+    countProbes(map, distance + 1);
+    return -1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Open addressing version of hashMapPut.
+ * @param map
+ * @param key
+ * @param length strlen(key)
+ * @param hash slotHash(map, key, length)
+ * @param value
+ */
+static void openMapPut(HashMap* map, const char* key, int length, unsigned int hash, int value)
+{
+    int index = openMapFind(map, key, length, hash);
+
+    // Update the value in place if the key is already present
+    if (index >= 0)
+    {
+        map->slots[index].value = value;
+        return;
+    }
+
+    // Grow before the new entry would push the load past the maximum
+    if (map->size + 1 > map->capacity * MAX_OPEN_TABLE_LOAD)
+    {
+        openMapResize(map, 2 * map->capacity);
+    }
+
+    // Build the slot, copying short keys inline
+    HashSlot entry;
+    entry.hash = hash;
+    entry.value = value;
+    entry.keyLength = length;
+    if (entry.keyLength < HASH_SLOT_INLINE)
+    {
+        memcpy(entry.key.bytes, key, entry.keyLength + 1);
+    }
+    else
+    {
+        entry.key.ptr = mapAlloc(map, entry.keyLength + 1);
+        memcpy(entry.key.ptr, key, entry.keyLength + 1);
+    }
+    openMapPlace(map, entry);
+    map->size++;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Open addressing version of hashMapRemove. Entries after the removed one are
+ * shifted back a slot until one is found in its home slot, so the table never
+ * needs tombstones.
+ * @param map
+ * @param key
+ */
+static void openMapRemove(HashMap* map, const char* key)
+{
+    int length = strlen(key);
+    int index = openMapFind(map, key, length, slotHash(map, key, length));
+    if (index < 0)
+    {
+        return;
+    }
+
+    // Free a heap allocated key
+    if (map->slots[index].keyLength >= HASH_SLOT_INLINE)
+    {
+        mapFree(map, map->slots[index].key.ptr, map->slots[index].keyLength + 1);
+    }
+
+    // Shift displaced entries back into the hole
+    int mask = map->capacity - 1;
+    int next = (index + 1) & mask;
+    while (map->slots[next].hash != 0 && slotDistance(map, next) > 0)
+    {
+        map->slots[index] = map->slots[next];
+        index = next;
+        next = (next + 1) & mask;
+    }
+    map->slots[index].hash = 0;
+    map->size--;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees every heap allocated key and the slot array of an open map. Keys in
+ * an arena are released all at once with it.
+ * @param map
+ */
+static void openMapCleanUp(HashMap* map)
+{
+    for (int i = 0; map->arena == NULL && i < map->capacity; i++)
+    {
+        if (map->slots[i].hash != 0 && map->slots[i].keyLength >= HASH_SLOT_INLINE)
+        {
+            free(map->slots[i].key.ptr);
+        }
+    }
+    if (map->arena != NULL)
+    {
+        arenaDelete(map->arena);
+        map->arena = NULL;
+    }
+    free(map->slots);
+    map->slots = NULL;
+    map->size = 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates a hash table map with the given storage layout. HASH_MAP_CHAINED
+ * behaves exactly like hashMapNew. HASH_MAP_OPEN rounds capacity up to a
+ * power of two slots and hashes with hashFnv1a, since linear probing needs
+ * well distributed hashes.
+ * @param capacity The number of buckets or slots.
+ * @param layout
+ * @return The allocated map.
+ */
+HashMap* hashMapNewLayout(int capacity, HashMapLayout layout)
+{
+    if (layout != HASH_MAP_OPEN)
+    {
+        return hashMapNew(capacity);
+    }
+    chooseKeyCompare();
+    HashMap* map = malloc(sizeof(HashMap));
+    openMapInit(map, capacity);
+    map->hash = hashFnv1a;
+    map->seed = 0;
+    map->arena = NULL;
+    map->resizeStep = 0;
+    map->version = 0;
+    map->stats = NULL;
+    return map;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Changes the hash function and seed the map places keys with. Links already
+ * in the map are rehashed into place at the current capacity.
+ * @param map
+ * @param hash One of the hash functions in hashMap.h or a caller's own.
+ * @param seed Seed passed to every call of hash. Use hashSeedRandom for maps
+ *             holding untrusted keys.
+ */
+void hashMapSetHash(HashMap* map, HashFunction hash, unsigned int seed)
+{
+    assert(map != NULL);
+    assert(hash != NULL);
+    assert(map->layout != HASH_MAP_MAPPED);
+    map->hash = hash;
+    map->seed = seed;
+    if (map->size == 0)
+    {
+        return;
+    }
+
+    if (map->layout == HASH_MAP_OPEN)
+    {
+        // Refresh the cached hashes, then place every slot again
+        for (int i = 0; i < map->capacity; i++)
+        {
+            if (map->slots[i].hash != 0)
+            {
+                map->slots[i].hash = slotHash(map, slotKey(&map->slots[i]),
+                                              map->slots[i].keyLength);
+            }
+        }
+        openMapResize(map, map->capacity);
+    }
+    else
+    {
+        // Refresh the cached hashes, then relink every chain
+        hashMapFinishResize(map);
+        for (int i = 0; i < map->capacity; i++)
+        {
+            for (HashLink* link = map->table[i]; link != NULL; link = link->next)
+            {
+                link->hash = keyHash(map, link->key, link->keyLength);
+            }
+        }
+        resizeTable(map, map->capacity);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Switches an empty map to allocating its links and keys from an arena.
+ * Each insert then bumps a pointer instead of calling malloc, removed links
+ * are recycled through the arena's free lists, and hashMapDelete frees whole
+ * blocks instead of every link.
+ * @param map An empty map.
+ */
+void hashMapUseArena(HashMap* map)
+{
+    assert(map != NULL);
+    assert(map->size == 0);
+    if (map->arena == NULL)
+    {
+        map->arena = arenaNew(ARENA_BLOCK_SIZE);
+    }
+}
+
+
+/*** HELPER CODE *************************************************************
+ * Free the allocated memory for a hash table link created with hashLinkNew.
+ * @param link
+ */
+static void hashLinkDelete(HashLink* link)
+{
+    free(link->key);
+    free(link);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates a link for the map, caching the key's hash in it. In an arena
+ * backed map the link and its key share a single allocation, otherwise this
+ * is hashLinkNew.
+ * @param map
+ * @param key Key string to copy in the link.
+ * @param length strlen(key)
+ * @param hash keyHash(map, key, length)
+ * @param value Value to set in the link.
+ * @param next Pointer to set as the link's next.
+ * @return The new link.
+ */
+static HashLink* mapLinkNew(HashMap* map, const char* key, int length, unsigned int hash,
+                            int value, HashLink* next)
+{
+    HashLink* link;
+    countAllocation(map, sizeof(HashLink) + length + 1);
+    if (map->arena == NULL)
+    {
+        link = hashLinkNew(key, value, next);
+    }
+    else
+    {
+        link = arenaAlloc(map->arena, sizeof(HashLink) + length + 1);
+        link->key = (char*)(link + 1);
+        memcpy(link->key, key, length + 1);
+        link->value = value;
+        link->next = next;
+    }
+    link->hash = hash;
+    link->keyLength = length;
+    return link;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees a link created with mapLinkNew.
+ * @param map
+ * @param link
+ */
+static void mapLinkDelete(HashMap* map, HashLink* link)
+{
+    if (map->arena == NULL)
+    {
+        hashLinkDelete(link);
+    }
+    else
+    {
+        arenaFree(map->arena, link, sizeof(HashLink) + link->keyLength + 1);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees every link in the map's buckets, leaving them empty.
+ * @param map
+ */
+static void freeChains(HashMap* map)
+{
+    // Loop over each bucket to delete all HashLinks
+    int i;
+    for(i = 0; i < map->capacity; i++)
+    {
+        // Create helper HashLink ptr and assign to first link in bucket
+        HashLink* garbage = map->table[i];
+            
+        // Traverse bucket to delete all HashLinks
+        while(garbage != NULL)
+        {
+            // Assign first bucket HashLink to next link
+            map->table[i] = garbage->next;
+                
+            // Delete garbage HashLink and assign garbage to bucket start
+            mapLinkDelete(map, garbage);
+            garbage = map->table[i];
+            
+            // Decrement size
+            map->size--;
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Removes all links in the map and frees all allocated memory. You can use
+ * hashLinkDelete to free the links. An arena backed map frees its blocks
+ * instead of visiting every link.
+ * @param maps
+ */
+void hashMapCleanUp(HashMap* map)
+{
+    assert(map != NULL);
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        openMapCleanUp(map);
+        return;
+    }
+    if(map->layout == HASH_MAP_MAPPED)
+    {
+        mappedCleanUp(map);
+        return;
+    }
+    hashMapFinishResize(map);
+
+    if(map->arena != NULL)
+    {
+        arenaDelete(map->arena);
+        map->arena = NULL;
+        map->size = 0;
+    }
+    else
+    {
+        freeChains(map);
+    }
+    //Free memory allocated for table
+    free(map->table);
+}
+
+
+/*** HELPER CODE *************************************************************
+ * Removes all links in the map and frees all allocated memory, including the
+ * map itself.
+ * @param map
+ */
+void hashMapDelete(HashMap* map)
+{
+    hashMapCleanUp(map);
+    free(map->stats);
+    free(map);
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a pointer to the value of the link with the given key and skip 
+ * traversing as well. Returns NULL if no link with that key is in the table.
+ * 
+ * Use the map's hash function and the map's capacity to find the index of the
+ * correct linked list bucket. Also make sure to search the entire list.
+ * 
+ * @param map
+ * @param key
+ * @return Link value or NULL if no matching link.
+ */
+int* hashMapGet(HashMap* map, const char* key)
+{
+    assert(map != NULL); 
+    assert(key != NULL);
+    int length = strlen(key);
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        int slot = openMapFind(map, key, length, slotHash(map, key, length));
+        countLookup(map, slot >= 0);
+        return slot < 0 ? NULL : &(map->slots[slot].value);
+    }
+    if(map->layout == HASH_MAP_MAPPED)
+    {
+        int entry = mappedFind(map, key, length);
+        countLookup(map, entry >= 0);
+        return entry < 0 ? NULL : (int*)&(map->snapshot->entries[entry].value);
+    }
+    
+    // Get the bucket for the given key
+    unsigned int hash = keyHash(map, key, length);
+    
+    // Create helper HashLink ptr and assign to first link of bucket
+    HashLink* curLink = *chainBucket(map, hash);
+    int probes = 0;
+    
+    // Traverse bucket  until curLink is NULL
+    while(curLink != NULL)
+    {
+        probes++;
+        // If curLink's key matches given key...
+        if(curLink->hash == hash && curLink->keyLength == length &&
+           keysEqual(curLink->key, key, length))
+        {
+            // Return reference to the value
+            countProbes(map, probes);
+            countLookup(map, 1);
+            return &(curLink->value);
+        }
+        // Else, assign curLink to next HashLink
+        else
+        {
+            curLink = curLink->next;
+        }
+    }
+    // If key is not found, return NULL
+    countProbes(map, probes);
+    countLookup(map, 0);
+    return NULL;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Moves every link of an old bucket onto the front of its bucket in the map's
+ * table, using the hash cached in the link.
+ * @param map
+ * @param link First link of the old bucket.
+ */
+static void relinkChain(HashMap* map, HashLink* link)
+{
+    while(link != NULL)
+    {
+        HashLink* next = link->next;
+        int index = link->hash % map->capacity;
+        link->next = map->table[index];
+        map->table[index] = link;
+        link = next;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bucket a key with the given hash lives in. While an incremental
+ * resize is under way, keys whose old bucket has not been moved yet are still
+ * found (and inserted) in the old table.
+ * @param map
+ * @param hash Hash of the key.
+ * @return Pointer to the head of the bucket's chain.
+ */
+static HashLink** chainBucket(HashMap* map, unsigned int hash)
+{
+    if(map->oldTable != NULL)
+    {
+        int oldIndex = hash % map->oldCapacity;
+        if(oldIndex >= map->migrated)
+        {
+            return &map->oldTable[oldIndex];
+        }
+    }
+    return &map->table[hash % map->capacity];
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Moves up to count buckets of an incremental resize from the old table into
+ * the new one, freeing the old table after its last bucket.
+ * @param map
+ * @param count Number of old buckets to move.
+ */
+static void migrateBuckets(HashMap* map, int count)
+{
+    while(map->oldTable != NULL && count-- > 0)
+    {
+        relinkChain(map, map->oldTable[map->migrated]);
+        map->oldTable[map->migrated] = NULL;
+        map->migrated++;
+        if(map->migrated == map->oldCapacity)
+        {
+            free(map->oldTable);
+            map->oldTable = NULL;
+            map->oldCapacity = 0;
+            map->migrated = 0;
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Starts an incremental resize. The current table becomes the old table and
+ * is emptied a few buckets at a time by later puts and removes.
+ * @param map
+ * @param capacity The new number of buckets.
+ */
+static void beginResize(HashMap* map, int capacity)
+{
+    hashMapFinishResize(map);
+    clock_t start = clock();
+    map->oldTable = map->table;
+    map->oldCapacity = map->capacity;
+    map->migrated = 0;
+    map->table = calloc(capacity, sizeof(HashLink*));
+    map->capacity = capacity;
+    countResize(map, start);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Completes any incremental resize under way, so every link is in map->table.
+ * Call this before walking the buckets directly.
+ * @param map
+ */
+void hashMapFinishResize(HashMap* map)
+{
+    assert(map != NULL);
+    if(map->oldTable != NULL)
+    {
+        migrateBuckets(map, map->oldCapacity - map->migrated);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Resizes the hash table to have a number of buckets equal to the given 
+ * capacity (double of the old capacity). After allocating the new table, 
+ * all of the links need to rehashed into it because the capacity has changed.
+ * 
+ * The links themselves are moved into the new buckets using the hash cached
+ * in each one, so nothing is hashed, copied, or allocated per link.
+ * 
+ * @param map
+ * @param capacity The new number of buckets.
+ */
+void resizeTable(HashMap* map, int capacity)
+{
+    assert(map != NULL);
+    hashMapFinishResize(map);
+    clock_t start = clock();
+    
+    // Hold on to the original table while the map gets a new one
+    HashLink** oldTable = map->table;
+    int oldCapacity = map->capacity;
+    int size = map->size;
+
+    // Initialize originally allocated hash map with new size
+    hashMapInit(map, capacity);
+    map->size = size;
+
+    // Relink the chain of each old bucket into the new table
+    int i;
+    for(i = 0; i < oldCapacity; i++)
+    {
+        relinkChain(map, oldTable[i]);
+    }
+    free(oldTable);
+    countResize(map, start);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Makes a chained map spread each resize across later operations instead of
+ * moving every link at once. Each put or remove moves up to bucketsPerOp old
+ * buckets, so no single call pays for the whole table.
+ * @param map A HASH_MAP_CHAINED map.
+ * @param bucketsPerOp Old buckets moved per operation, or 0 to resize all at
+ *                     once.
+ */
+void hashMapSetIncrementalResize(HashMap* map, int bucketsPerOp)
+{
+    assert(map != NULL);
+    assert(map->layout == HASH_MAP_CHAINED);
+    assert(bucketsPerOp >= 0);
+    map->resizeStep = bucketsPerOp;
+    if(bucketsPerOp == 0)
+    {
+        hashMapFinishResize(map);
+    }
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Updates the given key-value pair in the hash table. If a link with the given
+ * key already exists, this will just update the value and skip traversing. Otherwise, it will
+ * create a new link with the given key and value and add it to the table
+ * bucket's linked list. You can use hashLinkNew to create the link.
+ * 
+ * Use the map's hash function and the map's capacity to find the index of the
+ * correct linked list bucket.
+ * 
+ * @param map
+ * @param key
+ * @param value
+ */
+void hashMapPut(HashMap* map, const char* key, int value)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    assert(map->layout != HASH_MAP_MAPPED);
+    map->version++;
+    int size = map->size;
+    int length = strlen(key);
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        openMapPut(map, key, length, slotHash(map, key, length), value);
+        countUpdate(map, 1, 0, map->size - size);
+        return;
+    }
+
+    // Move a few buckets along if an incremental resize is under way
+    migrateBuckets(map, map->resizeStep);
+
+    // If table load exceeds maximum, double table size
+    if(hashMapTableLoad(map) >= MAX_TABLE_LOAD)
+    {
+        if(map->resizeStep > 0)
+        {
+            beginResize(map, 2 * hashMapCapacity(map));
+        }
+        else
+        {
+            resizeTable(map, 2 * hashMapCapacity(map));
+        }
+    }
+
+    // Get the bucket for the given key
+    unsigned int hash = keyHash(map, key, length);
+    HashLink** bucket = chainBucket(map, hash);
+
+    // Create helper HashLink and assign to first link in bucket
+    HashLink* curLink = *bucket;
+    int probes = 0;
+
+    // If curLink is NULL, add new value as first link in bucket
+    if(curLink == NULL)
+    {
+        *bucket = mapLinkNew(map, key, length, hash, value, NULL);
+        map->size++;
+    }
+    // Else, traverse the bucket's chain to get location to put key value pair
+    else
+    {
+        // Create loop control
+        int put = 0;    
+
+        // Traverse bucket until the key value pair is put into HashMap
+        while(put == 0)
+        {
+            probes++;
+            // If curLink's key equals the given key, replace the value
+            if(curLink->hash == hash && curLink->keyLength == length &&
+               keysEqual(curLink->key, key, length))
+            {
+                curLink->value = value;
+                put = 1;  // Change flag value to true
+            }
+            // If curLink's next ptr is NULL, create new link at curLink's next
+            else if(curLink->next == NULL)
+            {
+                curLink->next = mapLinkNew(map, key, length, hash, value, NULL);
+                map->size++;
+                put = 1;  // Change flag value to true
+            }
+            // Else, traverse to next link in bucket
+            else
+            {
+                curLink = curLink->next;
+            }
+        }   
+    }
+    countProbes(map, probes);
+    countUpdate(map, 1, 0, map->size - size);
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Grows the table so that count entries fit without another resize. Does
+ * nothing if the table is already large enough.
+ * @param map
+ * @param count Number of entries the map will hold.
+ */
+void hashMapReserve(HashMap* map, int count)
+{
+    assert(map != NULL);
+    assert(map->layout != HASH_MAP_MAPPED);
+    assert(count >= 0);
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        // Room for count entries and the probe before the next insert
+        int needed = (int)((count + 1) / MAX_OPEN_TABLE_LOAD) + 1;
+        if(needed > map->capacity)
+        {
+            openMapResize(map, needed);
+        }
+    }
+    else
+    {
+        // hashMapPut resizes once size / capacity reaches MAX_TABLE_LOAD
+        int needed = (int)(count / (float)MAX_TABLE_LOAD) + 1;
+        if(needed > map->capacity)
+        {
+            resizeTable(map, needed);
+        }
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Puts count key-value pairs into the map in one pass. The table is sized
+ * once up front, every key is hashed in a single tight loop, and then the
+ * entries are inserted without any load checks or resizes. Later duplicates
+ * of a key overwrite earlier ones, just like repeated hashMapPut calls.
+ * 
+ * With sortByBucket set the entries are inserted in bucket order, so the
+ * links of each chain (or neighbouring slots) are allocated next to each
+ * other, which makes later walks of the table touch far fewer cache lines
+ * in an arena backed map.
+ * 
+ * @param map
+ * @param keys
+ * @param values Value of each key, or NULL to store 0 for every key.
+ * @param count Number of keys.
+ * @param sortByBucket
+ */
+void hashMapBuildFrom(HashMap* map, const char** keys, const int* values,
+                      int count, int sortByBucket)
+{
+    assert(map != NULL);
+    assert(keys != NULL || count == 0);
+    map->version++;
+    int size = map->size;
+    hashMapFinishResize(map);
+    hashMapReserve(map, map->size + count);
+
+    // Measure and hash every key up front
+    unsigned int* hashes = malloc(sizeof(unsigned int) * (count + 1));
+    int* lengths = malloc(sizeof(int) * (count + 1));
+    for(int i = 0; i < count; i++)
+    {
+        lengths[i] = strlen(keys[i]);
+        hashes[i] = map->layout == HASH_MAP_OPEN ? slotHash(map, keys[i], lengths[i])
+                                                 : keyHash(map, keys[i], lengths[i]);
+    }
+
+    // Order the entries by bucket with a counting sort, or keep input order
+    int* order = malloc(sizeof(int) * (count + 1));
+    if(sortByBucket)
+    {
+        int mask = map->capacity - 1;
+        int* starts = calloc(map->capacity + 1, sizeof(int));
+        for(int i = 0; i < count; i++)
+        {
+            int bucket = map->layout == HASH_MAP_OPEN ? (int)(hashes[i] & mask) : (int)(hashes[i] % map->capacity);
+            starts[bucket + 1]++;
+        }
+        for(int b = 0; b < map->capacity; b++)
+        {
+            starts[b + 1] += starts[b];
+        }
+        for(int i = 0; i < count; i++)
+        {
+            int bucket = map->layout == HASH_MAP_OPEN ? (int)(hashes[i] & mask) : (int)(hashes[i] % map->capacity);
+            order[starts[bucket]++] = i;
+        }
+        free(starts);
+    }
+    else
+    {
+        for(int i = 0; i < count; i++)
+        {
+            order[i] = i;
+        }
+    }
+
+    // Insert each entry with its precomputed hash
+    for(int n = 0; n < count; n++)
+    {
+        int i = order[n];
+        int value = values != NULL ? values[i] : 0;
+        if(map->layout == HASH_MAP_OPEN)
+        {
+            openMapPut(map, keys[i], lengths[i], hashes[i], value);
+            continue;
+        }
+
+        // Overwrite a key that is already in the chain
+        HashLink** bucket = &map->table[hashes[i] % map->capacity];
+        HashLink* curLink = *bucket;
+        int probes = 0;
+        while(curLink != NULL && (curLink->hash != hashes[i] || curLink->keyLength != lengths[i] ||
+                                  !keysEqual(curLink->key, keys[i], lengths[i])))
+        {
+            curLink = curLink->next;
+            probes++;
+        }
+        countProbes(map, probes + (curLink != NULL));
+        if(curLink != NULL)
+        {
+            curLink->value = value;
+        }
+        else
+        {
+            *bucket = mapLinkNew(map, keys[i], lengths[i], hashes[i], value, *bucket);
+            map->size++;
+        }
+    }
+    free(order);
+    free(lengths);
+    free(hashes);
+    countUpdate(map, count, 0, map->size - size);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Removes and frees the link with the given key from the table. If no such link
+ * exists, this does nothing. Remember to search the entire linked list at the
+ * bucket. You can use hashLinkDelete to free the link.
+ * @param map
+ * @param key
+ */
+void hashMapRemove(HashMap* map, const char* key)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    assert(map->layout != HASH_MAP_MAPPED);
+    map->version++;
+    int size = map->size;
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        openMapRemove(map, key);
+        countUpdate(map, 0, 1, map->size - size);
+        return;
+    }
+    
+    // Move a few buckets along if an incremental resize is under way
+    migrateBuckets(map, map->resizeStep);
+
+    // Get the bucket for the given key
+    int length = strlen(key);
+    unsigned int hash = keyHash(map, key, length);
+    HashLink** bucket = chainBucket(map, hash);
+
+    // Create helper HashLink ptr to hold current link
+    HashLink* curLink = *bucket;
+    int probes = curLink != NULL;
+    
+    // If curLink is not NULL and its key matches the given key...
+    if(curLink != NULL && curLink->hash == hash && curLink->keyLength == length &&
+       keysEqual(curLink->key, key, length))
+    {
+        // Assign first link in bucket to next, delete curLink, & decrement map size
+        *bucket = curLink->next;
+        mapLinkDelete(map, curLink);
+        map->size--;
+    }
+    // If curLink is not NULL...
+    else if(curLink != NULL)
+    {
+        // Create helper HashLink ptr to hold previous link & assign curLink to next
+        HashLink* prev = curLink;
+        curLink = curLink->next;
+        int rmvFlag = 0;  // Flag indicating removal
+        
+        // Traverse bucket until curLink is NULL or HashLink removed
+        while(curLink != NULL && !rmvFlag)
+        {
+            probes++;
+            // If curLink's key matches given key...
+            if(curLink->hash == hash && curLink->keyLength == length &&
+               keysEqual(curLink->key, key, length))
+            {
+                // Assign prev's next to curLink's next & delete curLink
+                prev->next = curLink->next;
+                mapLinkDelete(map, curLink);
+
+                // Decrement size and set remove flag
+                map->size--;
+                rmvFlag = 1;
+            }
+            //If key does not match curLink's key...
+            else
+            {
+                // Assign curLink to prev and curLink to curLink's next
+                prev = curLink;
+                curLink = curLink->next;
+            }
+        }
+    }
+    countProbes(map, probes);
+    countUpdate(map, 0, 1, map->size - size);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns 1 if a link with the given key is in the table and 0 otherwise.
+ * 
+ * Use the map's hash function and the map's capacity to find the index of the
+ * correct linked list bucket. Also make sure to search the entire list.
+ * 
+ * @param map
+ * @param key
+ * @return 1 if the key is found, 0 otherwise.
  */
 int hashMapContainsKey(HashMap* map, const char* key)
 {
     assert(map != NULL);
-    assert(key != NULL);
-    
-    // Get index for the given key
-    int index = HASH_FUNCTION(key) % map->capacity;
+    assert(key != NULL);
+    int length = strlen(key);
+    if(map->layout == HASH_MAP_OPEN)
+    {
+        int found = openMapFind(map, key, length, slotHash(map, key, length)) >= 0;
+        countLookup(map, found);
+        return found;
+    }
+    if(map->layout == HASH_MAP_MAPPED)
+    {
+        int found = mappedFind(map, key, length) >= 0;
+        countLookup(map, found);
+        return found;
+    }
+    
+    // Get the bucket for the given key
+    unsigned int hash = keyHash(map, key, length);
+
+    // Create helper HashLink ptr and assign to first link in bucket
+    HashLink* curLink = *chainBucket(map, hash);
+    int probes = 0;
+
+    // Traverse bucket until curLink's key matches given key or curLink is NULL
+    while(curLink != NULL)
+    {
+        probes++;
+        // If key matches given key, return true
+        if(curLink->hash == hash && curLink->keyLength == length &&
+           keysEqual(curLink->key, key, length))
+        {
+            countProbes(map, probes);
+            countLookup(map, 1);
+            return 1;
+        }
+        // Else, traverse to next link
+        else
+        {
+            curLink = curLink->next;
+        }
+    }
+    // Key is not found, return false
+    countProbes(map, probes);
+    countLookup(map, 0);
+    return 0;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of links in the table.
+ * @param map
+ * @return Number of links in the table.
+ */
+int hashMapSize(HashMap* map)
+{
+    assert(map != NULL);
+    return map->size;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of buckets in the table.
+ * @param map
+ * @return Number of buckets in the table.
+ */
+int hashMapCapacity(HashMap* map)
+{
+    assert(map != NULL);
+    return map->capacity;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes of the map's table, arena or mapped file, leaving out the
+ * links and keys of a map without an arena.
+ * @param map
+ * @return Bytes held apart from links and keys.
+ */
+static size_t tableBytes(HashMap* map)
+{
+    if (map->layout == HASH_MAP_MAPPED)
+    {
+        return map->snapshot->imageSize;
+    }
+
+    size_t bytes;
+    if (map->layout == HASH_MAP_OPEN)
+    {
+        bytes = sizeof(HashSlot) * map->capacity;
+    }
+    else
+    {
+        bytes = sizeof(HashLink*) * ((size_t)map->capacity + map->oldCapacity);
+    }
+    if (map->arena != NULL)
+    {
+        bytes += map->arena->bytes;
+    }
+    return bytes;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Measures the table in one pass that only reads it. During an incremental
+ * resize the buckets not moved yet are measured too, as hashMapIteratorNext
+ * walks them, so measuring never finishes the resize.
+ * @param map
+ * @param counts If not NULL, bins search lengths to count as for
+ *               hashMapHistogram.
+ * @param bins Number of entries in counts.
+ * @param comparisons If not NULL, set to the key comparisons every successful
+ *                    search takes together.
+ * @param empty If not NULL, set to the number of empty buckets.
+ * @param bytes If not NULL, set to the bytes held as for hashMapBytes.
+ * @return The longest chain or probe in the table.
+ */
+static int measureTable(HashMap* map, int* counts, int bins, double* comparisons,
+                        int* empty, size_t* bytes)
+{
+    int buckets = map->capacity;
+    if (map->oldTable != NULL)
+    {
+        buckets += map->oldCapacity - map->migrated;
+    }
+    if (counts != NULL)
+    {
+        memset(counts, 0, sizeof(int) * bins);
+    }
+    int longest = 0;
+    double compared = 0;
+    int emptyCount = 0;
+    size_t keyBytes = 0;
+
+    for (int i = 0; i < buckets; i++)
+    {
+        int length = 0;
+        if (map->layout == HASH_MAP_OPEN)
+        {
+            // Empty slots are not searches
+            if (map->slots[i].hash == 0)
+            {
+                emptyCount++;
+                continue;
+            }
+            // An entry i slots from home is found on comparison i + 1
+            length = slotDistance(map, i);
+            compared += length + 1;
+            if (map->slots[i].keyLength >= HASH_SLOT_INLINE)
+            {
+                keyBytes += map->slots[i].keyLength + 1;
+            }
+        }
+        else if (map->layout == HASH_MAP_MAPPED)
+        {
+            // Entries of a bucket are found on comparisons 1..length
+            length = mappedBucketSize(map, i);
+            compared += (long)length * (length + 1) / 2;
+        }
+        else
+        {
+            // The links of a chain are found on comparisons 1..length
+            HashLink* link = i < map->capacity ? map->table[i]
+                                               : map->oldTable[map->migrated + i - map->capacity];
+            for (; link != NULL; link = link->next)
+            {
+                length++;
+                compared += length;
+                keyBytes += sizeof(HashLink) + link->keyLength + 1;
+            }
+        }
+        if (length == 0 && map->layout != HASH_MAP_OPEN)
+        {
+            emptyCount++;
+        }
+        if (counts != NULL)
+        {
+            counts[length < bins ? length : bins - 1]++;
+        }
+        if (length > longest)
+        {
+            longest = length;
+        }
+    }
+
+    if (comparisons != NULL)
+    {
+        *comparisons = compared;
+    }
+    if (empty != NULL)
+    {
+        *empty = emptyCount;
+    }
+    if (bytes != NULL)
+    {
+        // An arena already counts its links and keys
+        *bytes = tableBytes(map) + (map->arena == NULL ? keyBytes : 0);
+    }
+    return longest;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of table buckets without any links (or empty slots in an
+ * open map).
+ * @param map
+ * @return Number of empty buckets.
+ */
+int hashMapEmptyBuckets(HashMap* map)
+{
+    assert(map != NULL);
+    int empty;
+    measureTable(map, NULL, 0, NULL, &empty, NULL);
+    return empty;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes of memory the map holds: its table plus its links and
+ * keys, or every block of its arena, or the mapped file of a snapshot.
+ * @param map
+ * @return Bytes held by the map.
+ */
+size_t hashMapBytes(HashMap* map)
+{
+    assert(map != NULL);
+    if (map->layout == HASH_MAP_MAPPED || map->arena != NULL)
+    {
+        return tableBytes(map);
+    }
+    size_t bytes;
+    measureTable(map, NULL, 0, NULL, NULL, &bytes);
+    return bytes;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the ratio of (number of links) / (number of buckets) in the table.
+ * Remember that the buckets are linked lists, so this ratio tells you nothing
+ * about the number of empty buckets. Remember also that the load is a floating
+ * point number, so don't do integer division.
+ * @param map
+ * @return Table load.
+ */
+float hashMapTableLoad(HashMap* map)
+{
+    assert(map != NULL);
+    return (float)map->size / map->capacity;
+}
+
+/*** IMPLEMENT ***************************************************************
+ * Prints all the links in each of the buckets in the table.
+ * @param map
+ */
+void hashMapPrint(HashMap* map)
+{
+    assert(map != NULL);
+    hashMapFinishResize(map);
+
+    // Loop over each bucket
+    int i;
+    printf("\n");
+    for(i = 0; i < map->capacity; i++)
+    {
+        // Print bucket number
+        printf("%d - ", i);
+
+        // Open maps hold at most one entry per slot
+        if(map->layout == HASH_MAP_OPEN)
+        {
+            if(map->slots[i].hash != 0)
+            {
+                printf("{%s, %d} ", slotKey(&map->slots[i]), map->slots[i].value);
+            }
+            printf("\n");
+            continue;
+        }
+
+        // Mapped maps keep each bucket's entries side by side
+        if(map->layout == HASH_MAP_MAPPED)
+        {
+            HashSnapshot* snapshot = map->snapshot;
+            for(uint32_t e = snapshot->buckets[i]; e < snapshot->buckets[i + 1]; e++)
+            {
+                printf("{%s, %d} ", snapshot->keys + snapshot->entries[e].keyOffset,
+                       snapshot->entries[e].value);
+            }
+            printf("\n");
+            continue;
+        }
+
+        // Create helper HashLink ptr and assign to first link of bucket
+        HashLink* pLink = map->table[i];
+
+        // Traverse the bucket's chain...
+        while(pLink != NULL)
+        {
+            // Print key value pair & set pLink to next
+            printf("{%s, %d} ", pLink->key, pLink->value);
+            pLink = pLink->next;
+        }
+        printf("\n");
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Counts how long the searches in the table are. For a chained map
+ * counts[i] is the number of buckets holding i links. For an open map
+ * counts[i] is the number of entries found i slots past their home slot.
+ * Anything longer than bins - 1 is counted in the last bin.
+ * @param map
+ * @param counts Array of bins counts to fill.
+ * @param bins Number of entries in counts.
+ * @param average If not NULL, set to the average number of key comparisons
+ *                a successful search takes.
+ * @return The longest chain or probe in the table.
+ */
+int hashMapHistogram(HashMap* map, int* counts, int bins, double* average)
+{
+    assert(map != NULL);
+    assert(counts != NULL && bins > 0);
+    double comparisons;
+    int longest = measureTable(map, counts, bins, &comparisons, NULL, NULL);
+    if(average != NULL)
+    {
+        *average = map->size ? comparisons / map->size : 0;
+    }
+    return longest;
+}
 
-    // Create helper HashLink ptr and assign to first link in bucket
-    HashLink* curLink = map->table[index];
 
-    // Traverse bucket until curLink's key matches given key or curLink is NULL
-    while(curLink != NULL)
+/*** IMPLEMENT ***************************************************************
+ * Prints the chain length (or probe length) histogram of the table with the
+ * longest search and the average search length over all entries.
+ * @param map
+ */
+void hashMapPrintHistogram(HashMap* map)
+{
+    assert(map != NULL);
+    int counts[HISTOGRAM_BINS];
+    double average;
+    int longest = hashMapHistogram(map, counts, HISTOGRAM_BINS, &average);
+
+    const char* label = map->layout == HASH_MAP_OPEN ? "probe" : "chain";
+    for(int i = 0; i < HISTOGRAM_BINS; i++)
     {
-        // If key matches given key, return true
-        if(strcmp(curLink->key, key) == 0)
+        if(counts[i] != 0)
+        {
+            printf("%s %s%2d: %d\n", label, i == HISTOGRAM_BINS - 1 ? ">=" : "  ", i, counts[i]);
+        }
+    }
+    printf("longest %s: %d\n", label, longest);
+    printf("average comparisons per hit: %.2f\n", average);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Points an iterator at the start of one pass over its share of the map.
+ * @param iterator
+ * @param pass 0 for the table, slots or snapshot entries, 1 for the buckets
+ *             of an incremental resize.
+ */
+static void iteratorStartPass(HashMapIterator* iterator, int pass)
+{
+    HashMap* map = iterator->map;
+    long length;
+    if(pass == 1)
+    {
+        length = map->oldTable != NULL ? map->oldCapacity : 0;
+    }
+    else
+    {
+        // Snapshot entries are stored grouped by bucket, so walk them directly
+        length = map->layout == HASH_MAP_MAPPED ? map->size : map->capacity;
+    }
+    iterator->pass = pass;
+    iterator->next = length * iterator->share / iterator->shares;
+    iterator->end = length * (iterator->share + 1) / iterator->shares;
+    iterator->link = NULL;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Starts a walk over every entry of a map. Entries are visited in the order
+ * they lie in the table, which for an open or mapped map, or an arena backed
+ * map built with hashMapBuildFrom sorted by bucket, is also memory order.
+ * Walking only reads the map, so any number of iterators may walk one map at
+ * once, but the map must not change while they do.
+ * @param map
+ * @param iterator Set up for hashMapIteratorNext.
+ */
+void hashMapIteratorInit(HashMap* map, HashMapIterator* iterator)
+{
+    hashMapIteratorInitShare(map, iterator, 0, 1);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Starts a walk over one of shares equal, contiguous parts of a map, so
+ * threads can split a full scan between them. The shares together visit
+ * every entry exactly once, including entries an incremental resize has not
+ * moved yet.
+ * @param map
+ * @param iterator Set up for hashMapIteratorNext.
+ * @param share Part to walk, in [0, shares).
+ * @param shares Number of parts.
+ */
+void hashMapIteratorInitShare(HashMap* map, HashMapIterator* iterator, int share,
+                              int shares)
+{
+    assert(map != NULL && iterator != NULL);
+    assert(shares > 0 && share >= 0 && share < shares);
+    iterator->map = map;
+    iterator->share = share;
+    iterator->shares = shares;
+    iteratorStartPass(iterator, 0);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Moves an iterator to the next entry of its walk.
+ * @param iterator
+ * @param key If not NULL, set to the entry's key, owned by the map.
+ * @param value If not NULL, set to the entry's value.
+ * @return 1 if there was another entry, 0 once the walk is over.
+ */
+int hashMapIteratorNext(HashMapIterator* iterator, const char** key, int* value)
+{
+    assert(iterator != NULL);
+    HashMap* map = iterator->map;
+    while(1)
+    {
+        // Finish the chain under way
+        HashLink* link = iterator->link;
+        if(link != NULL)
         {
+            iterator->link = link->next;
+            if(key != NULL)
+            {
+                *key = link->key;
+            }
+            if(value != NULL)
+            {
+                *value = link->value;
+            }
+            return 1;
+        }
+
+        // Move to the old buckets at the end of the share, then stop
+        if(iterator->next >= iterator->end)
+        {
+            if(iterator->pass == 0 && map->oldTable != NULL)
+            {
+                iteratorStartPass(iterator, 1);
+                continue;
+            }
+            return 0;
+        }
+
+        int i = iterator->next++;
+        if(map->layout == HASH_MAP_OPEN)
+        {
+            if(map->slots[i].hash != 0)
+            {
+                if(key != NULL)
+                {
+                    *key = slotKey(&map->slots[i]);
+                }
+                if(value != NULL)
+                {
+                    *value = map->slots[i].value;
+                }
+                return 1;
+            }
+        }
+        else if(map->layout == HASH_MAP_MAPPED)
+        {
+            const SnapshotEntry* entry = &map->snapshot->entries[i];
+            if(key != NULL)
+            {
+                *key = map->snapshot->keys + entry->keyOffset;
+            }
+            if(value != NULL)
+            {
+                *value = entry->value;
+            }
             return 1;
         }
-        // Else, traverse to next link
         else
         {
-            curLink = curLink->next;
+            iterator->link = iterator->pass == 0 ? map->table[i] : map->oldTable[i];
         }
     }
-    // Key is not found, return false
-    return 0;
 }
 
+
+// A hashMapForEach split across the workers of a pool.
+typedef struct ForEachJob
+{
+    HashMap* map;
+    HashMapVisit visit;
+    void* arg;
+} ForEachJob;
+
+/*** IMPLEMENT ***************************************************************
+ * Visits one worker's share of the entries of a hashMapForEach.
+ * @param arg ForEachJob.
+ * @param worker
+ * @param workers
+ */
+static void forEachTask(void* arg, int worker, int workers)
+{
+    ForEachJob* job = arg;
+    HashMapIterator iterator;
+    hashMapIteratorInitShare(job->map, &iterator, worker, workers);
+    const char* key;
+    int value;
+    while(hashMapIteratorNext(&iterator, &key, &value))
+    {
+        job->visit(key, value, job->arg, worker);
+    }
+}
+
+
 /*** IMPLEMENT ***************************************************************
- * Returns the number of links in the table.
+ * Calls visit for every entry of the map. With a pool, each worker walks a
+ * contiguous share of the table at the same time, so visit must be safe to
+ * call from several threads; the worker number lets it keep results per
+ * worker instead of locking. The map is only read.
  * @param map
- * @return Number of links in the table.
+ * @param visit
+ * @param arg Passed to every call of visit.
+ * @param pool Workers to split the walk across, or NULL to walk on this
+ *             thread.
  */
-int hashMapSize(HashMap* map)
+void hashMapForEach(HashMap* map, HashMapVisit visit, void* arg, WorkerPool* pool)
 {
-    assert(map != NULL);
-    return map->size;
+    assert(map != NULL && visit != NULL);
+    ForEachJob job = {map, visit, arg};
+    if(pool == NULL)
+    {
+        forEachTask(&job, 0, 1);
+    }
+    else
+    {
+        workerPoolRun(pool, forEachTask, &job);
+    }
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Returns the number of buckets in the table.
+ * Makes the map count its operations, searches, resizes and allocations from
+ * now on. Each operation then costs an extra branch and a few additions, so
+ * stats can be left on in production. Does nothing if already enabled.
  * @param map
- * @return Number of buckets in the table.
  */
-int hashMapCapacity(HashMap* map)
+void hashMapEnableStats(HashMap* map)
 {
     assert(map != NULL);
-    return map->capacity;
+    if(map->stats == NULL)
+    {
+        map->stats = calloc(1, sizeof(HashMapStats));
+    }
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Returns the number of table buckets without any links.
+ * Zeroes the counters of a map with stats enabled, so a workload can be
+ * measured apart from the loading before it.
  * @param map
- * @return Number of empty buckets.
  */
-int hashMapEmptyBuckets(HashMap* map)
+void hashMapResetStats(HashMap* map)
 {
     assert(map != NULL);
-    
-    // Create accumulator variable and loop control
-    int empty = 0;
-    int b;
+    if(map->stats != NULL)
+    {
+        memset(map->stats, 0, sizeof(HashMapStats));
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Fills stats with the map's counters, all 0 unless hashMapEnableStats was
+ * called, and with the load, empty buckets, chain or probe histogram and
+ * bytes measured from the table now. Measuring walks the whole table once and
+ * only reads it.
+ * @param map
+ * @param stats Filled in.
+ */
+void hashMapGetStats(HashMap* map, HashMapStats* stats)
+{
+    assert(map != NULL && stats != NULL);
+    if(map->stats != NULL)
+    {
+        *stats = *map->stats;
+    }
+    else
+    {
+        memset(stats, 0, sizeof(HashMapStats));
+    }
+    stats->size = hashMapSize(map);
+    stats->capacity = hashMapCapacity(map);
+    stats->load = hashMapTableLoad(map);
+
+    // Measure everything else in one pass that leaves a resize under way
+    double comparisons;
+    stats->longestChain = measureTable(map, stats->histogram, HISTOGRAM_BINS, &comparisons,
+                                       &stats->emptyBuckets, &stats->bytes);
+    stats->averageSearch = stats->size ? comparisons / stats->size : 0;
+}
+
 
-    // Loop over the hash map buckets and increment accumulator if empty
-    for(b = 0; b < map->capacity; b++)
+/*** IMPLEMENT ***************************************************************
+ * Prints the map's statistics: its shape and memory, then the operation
+ * counters if stats are enabled.
+ * @param map
+ * @param output Stream to print to.
+ */
+void hashMapPrintStats(HashMap* map, FILE* output)
+{
+    assert(map != NULL && output != NULL);
+    HashMapStats stats;
+    hashMapGetStats(map, &stats);
+    const char* label = map->layout == HASH_MAP_OPEN ? "probe" : "chain";
+
+    fprintf(output, "size %d, capacity %d, load %.3f, %d empty buckets, %zu bytes\n",
+            stats.size, stats.capacity, stats.load, stats.emptyBuckets, stats.bytes);
+    fprintf(output, "longest %s %d, average comparisons per hit %.2f, lengths", label,
+            stats.longestChain, stats.averageSearch);
+    for(int i = 0; i < HISTOGRAM_BINS; i++)
     {
-        if(map->table[b] == NULL)
+        if(stats.histogram[i] != 0)
         {
-            empty++;
+            fprintf(output, " %s%d:%d", i == HISTOGRAM_BINS - 1 ? ">=" : "", i,
+                    stats.histogram[i]);
         }
     }
-    return empty;
+    fprintf(output, "\n");
+    if(map->stats == NULL)
+    {
+        return;
+    }
+
+    long long searches = stats.lookups + stats.puts + stats.removes;
+    fprintf(output, "%lld lookups (%lld hits), %lld puts (%lld new), %lld removes (%lld found)\n",
+            stats.lookups, stats.hits, stats.puts, stats.inserts, stats.removes,
+            stats.removed);
+    fprintf(output, "%.2f probes per operation, longest search %d\n",
+            searches ? (double)stats.probes / searches : 0.0, stats.longestProbe);
+    fprintf(output, "%d resizes in %.3f seconds, %lld allocations of %lld bytes\n",
+            stats.resizes, stats.resizeSeconds, stats.allocations, stats.allocatedBytes);
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Returns the ratio of (number of links) / (number of buckets) in the table.
- * Remember that the buckets are linked lists, so this ratio tells you nothing
- * about the number of empty buckets. Remember also that the load is a floating
- * point number, so don't do integer division.
- * @param map
- * @return Table load.
+ * Returns the index of the snapshot entry holding key, or -1.
+ * @param map A HASH_MAP_MAPPED map.
+ * @param key
+ * @param length strlen(key)
+ * @return Entry index or -1.
  */
-float hashMapTableLoad(HashMap* map)
+static int mappedFind(HashMap* map, const char* key, int length)
 {
-    assert(map != NULL);
-    return (map->size)/(map->capacity);
+    HashSnapshot* snapshot = map->snapshot;
+    unsigned int hash = keyHash(map, key, length);
+    unsigned int bucket = hash & (map->capacity - 1);
+    for(uint32_t i = snapshot->buckets[bucket]; i < snapshot->buckets[bucket + 1]; i++)
+    {
+        const SnapshotEntry* entry = &snapshot->entries[i];
+        if(entry->hash == hash && entry->keyLength == (uint32_t)length &&
+           keysEqual(snapshot->keys + entry->keyOffset, key, length))
+        {
+            countProbes(map, i - snapshot->buckets[bucket] + 1);
+            return i;
+        }
+    }
+    countProbes(map, snapshot->buckets[bucket + 1] - snapshot->buckets[bucket]);
+    return -1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of keys in one bucket of a mapped map.
+ * @param map A HASH_MAP_MAPPED map.
+ * @param bucket
+ * @return Number of entries in the bucket.
+ */
+static int mappedBucketSize(HashMap* map, int bucket)
+{
+    return map->snapshot->buckets[bucket + 1] - map->snapshot->buckets[bucket];
 }
 
+
 /*** IMPLEMENT ***************************************************************
- * Prints all the links in each of the buckets in the table.
+ * Unmaps the image of a mapped map.
+ * @param map A HASH_MAP_MAPPED map.
+ */
+static void mappedCleanUp(HashMap* map)
+{
+    munmap(map->snapshot->image, map->snapshot->imageSize);
+    free(map->snapshot);
+    map->snapshot = NULL;
+    map->size = 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Copies pointers to every key and its value out of a map of any layout.
  * @param map
+ * @param keys Array of hashMapSize(map) key pointers to fill. The keys stay
+ *             owned by the map.
+ * @param values Array of hashMapSize(map) values to fill.
  */
-void hashMapPrint(HashMap* map)
+static void collectEntries(HashMap* map, const char** keys, int* values)
+{
+    int n = 0;
+    HashMapIterator iterator;
+    hashMapIteratorInit(map, &iterator);
+    while(hashMapIteratorNext(&iterator, &keys[n], &values[n]))
+    {
+        n++;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Writes a snapshot of the map to a file that hashMapOpenSnapshot can map.
+ * @param map Map of any layout.
+ * @param path
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int hashMapSaveSnapshot(HashMap* map, const char* path)
 {
     assert(map != NULL);
+    assert(path != NULL);
+    int count = map->size;
+    const char** keys = malloc(sizeof(char*) * (count + 1));
+    int* values = malloc(sizeof(int) * (count + 1));
+    collectEntries(map, keys, values);
 
-    // Loop over each bucket
-    int i;
-    printf("\n");
-    for(i = 0; i < map->capacity; i++)
+    // Size the header and every section
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.seed = 0;
+    header.bucketCount = 8;
+    while(header.bucketCount < (uint32_t)count)
     {
-        // Create helper HashLink ptr and assign to first link of bucket
-        HashLink* pLink = map->table[i];
-        
-        // Print bucket number
-        printf("%d - ", i);
+        header.bucketCount *= 2;
+    }
+    header.entryCount = count;
+    for(int i = 0; i < count; i++)
+    {
+        header.keyBytes += strlen(keys[i]) + 1;
+    }
+    header.bucketsOffset = sizeof(SnapshotHeader);
+    header.entriesOffset = header.bucketsOffset + sizeof(uint32_t) * (header.bucketCount + 1);
+    header.entriesOffset = (header.entriesOffset + 7) & ~(uint64_t)7;
+    header.keysOffset = header.entriesOffset + sizeof(SnapshotEntry) * count;
+    header.fileSize = header.keysOffset + header.keyBytes;
 
-        // Traverse the bucket's chain...
-        while(pLink != NULL)
+    // Count the keys of each bucket, then turn the counts into offsets
+    uint32_t mask = header.bucketCount - 1;
+    uint32_t* buckets = calloc(header.bucketCount + 1, sizeof(uint32_t));
+    uint32_t* hashes = malloc(sizeof(uint32_t) * (count + 1));
+    for(int i = 0; i < count; i++)
+    {
+        hashes[i] = hashFnv1a(keys[i], header.seed);
+        buckets[(hashes[i] & mask) + 1]++;
+    }
+    for(uint32_t b = 0; b < header.bucketCount; b++)
+    {
+        buckets[b + 1] += buckets[b];
+    }
+
+    // Place each entry in its bucket
+    SnapshotEntry* entries = malloc(sizeof(SnapshotEntry) * (count + 1));
+    uint32_t* next = malloc(sizeof(uint32_t) * header.bucketCount);
+    memcpy(next, buckets, sizeof(uint32_t) * header.bucketCount);
+    int* order = malloc(sizeof(int) * (count + 1));
+    for(int i = 0; i < count; i++)
+    {
+        uint32_t e = next[hashes[i] & mask]++;
+        entries[e].hash = hashes[i];
+        entries[e].value = values[i];
+        order[e] = i;
+    }
+
+    // Lay the keys out in entry order, so a walk over the entries reads the
+    // blob front to back
+    char* blob = malloc(header.keyBytes + 1);
+    uint32_t keyOffset = 0;
+    for(int e = 0; e < count; e++)
+    {
+        const char* key = keys[order[e]];
+        entries[e].keyOffset = keyOffset;
+        entries[e].keyLength = strlen(key);
+        memcpy(blob + keyOffset, key, entries[e].keyLength + 1);
+        keyOffset += entries[e].keyLength + 1;
+    }
+
+    // Write the sections at their offsets
+    int status = -1;
+    FILE* file = fopen(path, "wb");
+    if(file != NULL)
+    {
+        static const char zeros[8] = {0};
+        size_t bucketBytes = sizeof(uint32_t) * (header.bucketCount + 1);
+        size_t padding = header.entriesOffset - header.bucketsOffset - bucketBytes;
+        if(fwrite(&header, sizeof(header), 1, file) == 1 &&
+           fwrite(buckets, bucketBytes, 1, file) == 1 &&
+           fwrite(zeros, 1, padding, file) == padding &&
+           fwrite(entries, sizeof(SnapshotEntry), count, file) == (size_t)count &&
+           fwrite(blob, 1, header.keyBytes, file) == header.keyBytes)
         {
-            // Print key value pair & set pLink to next
-            printf("{%s, %d} ", pLink->key, pLink->value);
-            pLink = pLink->next;
+            status = 0;
         }
-        printf("\n");
+        if(fclose(file) != 0)
+        {
+            status = -1;
+        }
+    }
+
+    free(blob);
+    free(order);
+    free(next);
+    free(entries);
+    free(hashes);
+    free(buckets);
+    free(values);
+    free(keys);
+    return status;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Checks that a mapped snapshot's header, bucket offsets and entries all lie
+ * inside the file, so lookups on a truncated or corrupt file cannot read
+ * outside the mapping.
+ * @param image
+ * @param size Bytes mapped.
+ * @return 1 if the snapshot can be used, 0 if not.
+ */
+static int snapshotValid(const void* image, size_t size)
+{
+    const SnapshotHeader* header = image;
+    uint64_t bucketBytes = sizeof(uint32_t) * ((uint64_t)header->bucketCount + 1);
+    uint64_t entryBytes = sizeof(SnapshotEntry) * (uint64_t)header->entryCount;
+    if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+       header->fileSize != (uint64_t)size ||
+       header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0 ||
+       header->bucketCount > INT_MAX || header->entryCount > INT_MAX ||
+       header->bucketsOffset < sizeof(SnapshotHeader) || header->bucketsOffset % 4 != 0 ||
+       header->entriesOffset < header->bucketsOffset || header->entriesOffset % 4 != 0 ||
+       header->keysOffset < header->entriesOffset || header->keysOffset > size ||
+       bucketBytes > header->entriesOffset - header->bucketsOffset ||
+       entryBytes > header->keysOffset - header->entriesOffset ||
+       header->keyBytes != size - header->keysOffset)
+    {
+        return 0;
+    }
+
+    // Every bucket must own a slice of the entries, in order
+    const uint32_t* buckets = (const uint32_t*)((const char*)image + header->bucketsOffset);
+    if(buckets[0] != 0 || buckets[header->bucketCount] != header->entryCount)
+    {
+        return 0;
+    }
+    for(uint32_t b = 0; b < header->bucketCount; b++)
+    {
+        if(buckets[b] > buckets[b + 1])
+        {
+            return 0;
+        }
+    }
+
+    // Every key must end with its terminator inside the key blob
+    const SnapshotEntry* entries =
+        (const SnapshotEntry*)((const char*)image + header->entriesOffset);
+    const char* keys = (const char*)image + header->keysOffset;
+    for(uint32_t i = 0; i < header->entryCount; i++)
+    {
+        if(entries[i].keyOffset >= header->keyBytes ||
+           entries[i].keyLength >= header->keyBytes - entries[i].keyOffset ||
+           keys[entries[i].keyOffset + entries[i].keyLength] != '\0')
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Maps a snapshot written by hashMapSaveSnapshot and returns a map that
+ * answers lookups straight from the mapping, with no parsing and no
+ * allocation per key. The map has layout HASH_MAP_MAPPED and is read-only:
+ * hashMapPut and hashMapRemove may not be called on it. Values returned by
+ * hashMapGet may be written; the page is then copied for this process only.
+ * @param path
+ * @return The map, or NULL if the file is missing, not a snapshot, or
+ *         truncated or corrupt.
+ */
+HashMap* hashMapOpenSnapshot(const char* path)
+{
+    assert(path != NULL);
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    void* image = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(image == MAP_FAILED)
+    {
+        return NULL;
     }
-}
\ No newline at end of file
+
+    // Check the header describes this file
+    const SnapshotHeader* header = image;
+    if(!snapshotValid(image, info.st_size))
+    {
+        munmap(image, info.st_size);
+        return NULL;
+    }
+
+    HashSnapshot* snapshot = malloc(sizeof(HashSnapshot));
+    snapshot->image = image;
+    snapshot->imageSize = info.st_size;
+    snapshot->buckets = (const uint32_t*)((char*)image + header->bucketsOffset);
+    snapshot->entries = (SnapshotEntry*)((char*)image + header->entriesOffset);
+    snapshot->keys = (const char*)image + header->keysOffset;
+
+    chooseKeyCompare();
+    HashMap* map = malloc(sizeof(HashMap));
+    map->layout = HASH_MAP_MAPPED;
+    map->table = NULL;
+    map->slots = NULL;
+    map->oldTable = NULL;
+    map->oldCapacity = 0;
+    map->migrated = 0;
+    map->capacity = header->bucketCount;
+    map->size = header->entryCount;
+    map->hash = hashFnv1a;
+    map->seed = header->seed;
+    map->arena = NULL;
+    map->resizeStep = 0;
+    map->version = 0;
+    map->stats = NULL;
+    map->snapshot = snapshot;
+    return map;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Copies every key and value of a map into a new map of the given layout.
+ * Useful for getting a writable map from a mapped snapshot.
+ * @param map Map of any layout.
+ * @param layout HASH_MAP_CHAINED or HASH_MAP_OPEN.
+ * @return The new map, hashed with hashFnv1a and arena backed.
+ */
+HashMap* hashMapClone(HashMap* map, HashMapLayout layout)
+{
+    assert(map != NULL);
+    assert(layout != HASH_MAP_MAPPED);
+    int count = map->size;
+    const char** keys = malloc(sizeof(char*) * (count + 1));
+    int* values = malloc(sizeof(int) * (count + 1));
+    collectEntries(map, keys, values);
+
+    HashMap* clone = hashMapNewLayout(count, layout);
+    hashMapSetHash(clone, hashFnv1a, 0);
+    hashMapUseArena(clone);
+    hashMapBuildFrom(clone, keys, values, count, 1);
+    free(values);
+    free(keys);
+    return clone;
+}
@@ -9,30 +9,193 @@
  * Description: Header file for Hash Map ADT. Provided by instructor.
  *****************************************************************************/
 
+#include "workerPool.h"
+#include <stddef.h>
+#include <stdio.h>
+
+// Hash function new chained maps start with. See hashMapSetHash.
 #define HASH_FUNCTION hashFunction1
+// Chained tables resize once they hold this many links per bucket. Both
+// loads can be tuned per build, e.g. make CFLAGS="... -DMAX_TABLE_LOAD=2".
+#ifndef MAX_TABLE_LOAD
 #define MAX_TABLE_LOAD 1
+#endif
+// Open addressing tables resize once this fraction of the slots is in use.
+#ifndef MAX_OPEN_TABLE_LOAD
+#define MAX_OPEN_TABLE_LOAD 0.875
+#endif
+// Keys shorter than this many bytes are stored inside the open table's slots.
+#define HASH_SLOT_INLINE 16
+// Keys at least this long are compared with SSE2 or AVX2 where the processor
+// has them, shorter keys with memcmp.
+#define HASH_KEY_SIMD_LENGTH 16
+// Number of bins hashMapPrintHistogram reports.
+#define HISTOGRAM_BINS 16
 
+typedef struct Arena Arena;
 typedef struct HashMap HashMap;
 typedef struct HashLink HashLink;
+typedef struct HashSlot HashSlot;
+typedef struct HashSnapshot HashSnapshot;
+typedef struct HashMapStats HashMapStats;
+typedef struct HashMapIterator HashMapIterator;
+
+// Hashes a null terminated key. Functions that do not use a seed ignore it.
+typedef unsigned int (*HashFunction)(const char* key, unsigned int seed);
+
+// Called by hashMapForEach for every entry. worker is the pool worker
+// visiting it, in [0, workers), so visits can collect results per worker.
+typedef void (*HashMapVisit)(const char* key, int value, void* arg, int worker);
+
+// Storage layouts a map can be created with.
+typedef enum HashMapLayout
+{
+    // Array of buckets, each holding a linked list of heap allocated links.
+    HASH_MAP_CHAINED,
+    // Flat array of slots probed linearly using Robin Hood hashing.
+    HASH_MAP_OPEN,
+    // Read-only snapshot file mapped into memory. See hashMapOpenSnapshot.
+    HASH_MAP_MAPPED
+} HashMapLayout;
 
 struct HashLink
 {
     char* key;
     int value;
+    // Hash of the key, so resizing never rehashes it.
+    unsigned int hash;
+    // Length of the key without the null terminator, so keys of another
+    // length are passed over without reading their bytes.
+    int keyLength;
     HashLink* next;
 };
 
+struct HashSlot
+{
+    // Cached hash of the key. 0 marks an empty slot.
+    unsigned int hash;
+    int value;
+    // Length of the key without the null terminator.
+    int keyLength;
+    // Keys shorter than HASH_SLOT_INLINE are copied into bytes, longer keys
+    // are heap allocated.
+    union
+    {
+        char* ptr;
+        char bytes[HASH_SLOT_INLINE];
+    } key;
+};
+
+// Position of a walk over a map's entries. See hashMapIteratorInit.
+struct HashMapIterator
+{
+    HashMap* map;
+    // 0 while walking the table, slots or snapshot entries, 1 while walking
+    // buckets an incremental resize has not moved yet.
+    int pass;
+    // Share of the table being walked, out of shares.
+    int share;
+    int shares;
+    // Next bucket, slot or entry of the share, and the end of the share.
+    int next;
+    int end;
+    // Next link of the chain being walked.
+    HashLink* link;
+};
+
+// Counters a map keeps once hashMapEnableStats is called, plus figures
+// hashMapGetStats measures from the table when asked.
+struct HashMapStats
+{
+    // hashMapGet and hashMapContainsKey calls, and how many found the key.
+    long long lookups;
+    long long hits;
+    // hashMapPut calls, and how many added a new key rather than updating.
+    long long puts;
+    long long inserts;
+    // hashMapRemove calls, and how many found the key.
+    long long removes;
+    long long removed;
+    // Key comparisons (chained and mapped) or slots examined (open) by every
+    // search, and the most any one search took.
+    long long probes;
+    int longestProbe;
+    // Table resizes and the processor time they took.
+    int resizes;
+    double resizeSeconds;
+    // Links and keys allocated over the map's life, and their bytes.
+    long long allocations;
+    long long allocatedBytes;
+
+    // Measured by hashMapGetStats.
+    int size;
+    int capacity;
+    double load;
+    int emptyBuckets;
+    // Chain or probe length distribution, as hashMapHistogram counts it.
+    int histogram[HISTOGRAM_BINS];
+    int longestChain;
+    double averageSearch;
+    size_t bytes;
+};
+
 struct HashMap
 {
+    HashMapLayout layout;
+    // Buckets of a HASH_MAP_CHAINED map.
     HashLink** table;
+    // Slots of a HASH_MAP_OPEN map.
+    HashSlot* slots;
+    // Mapped file of a HASH_MAP_MAPPED map.
+    HashSnapshot* snapshot;
     // Number of links in the table.
     int size;
-    // Number of buckets in the table.
+    // Number of buckets (or slots) in the table.
     int capacity;
+    HashFunction hash;
+    unsigned int seed;
+    // Allocator for links and keys, or NULL to use malloc. See hashMapUseArena.
+    Arena* arena;
+    // Buckets still being emptied into table by an incremental resize, or NULL.
+    HashLink** oldTable;
+    int oldCapacity;
+    // Number of oldTable buckets already moved.
+    int migrated;
+    // Old buckets moved per put or remove, or 0 to resize all at once.
+    int resizeStep;
+    // Bumped by every put and remove, so results cached from the map can be
+    // recognised as stale.
+    unsigned long version;
+    // Operation counters, or NULL until hashMapEnableStats. Not atomic, so a
+    // map with stats must not be searched by several threads at once.
+    HashMapStats* stats;
 };
 
+// Sum of the key's bytes. Anagrams always collide.
+unsigned int hashFunction1(const char* key, unsigned int seed);
+// Sum of the key's bytes weighted by position.
+unsigned int hashFunction2(const char* key, unsigned int seed);
+// FNV-1a, well distributed and fast on short keys.
+unsigned int hashFnv1a(const char* key, unsigned int seed);
+// wyhash-style multiply mixing, fastest on long keys and resists collision
+// flooding when seeded with hashSeedRandom.
+unsigned int hashWy(const char* key, unsigned int seed);
+unsigned int hashWyBytes(const void* key, size_t length, unsigned int seed);
+unsigned int hashSeedRandom();
+
 HashMap* hashMapNew(int capacity);
+HashMap* hashMapNewLayout(int capacity, HashMapLayout layout);
+void hashMapSetHash(HashMap* map, HashFunction hash, unsigned int seed);
+void hashMapUseArena(HashMap* map);
+void hashMapSetIncrementalResize(HashMap* map, int bucketsPerOp);
+void hashMapFinishResize(HashMap* map);
+void hashMapReserve(HashMap* map, int count);
+void hashMapBuildFrom(HashMap* map, const char** keys, const int* values,
+                      int count, int sortByBucket);
 void hashMapDelete(HashMap* map);
+int hashMapSaveSnapshot(HashMap* map, const char* path);
+HashMap* hashMapOpenSnapshot(const char* path);
+HashMap* hashMapClone(HashMap* map, HashMapLayout layout);
 int* hashMapGet(HashMap* map, const char* key);
 void hashMapPut(HashMap* map, const char* key, int value);
 void hashMapRemove(HashMap* map, const char* key);
@@ -42,6 +205,18 @@ int hashMapSize(HashMap* map);
 int hashMapCapacity(HashMap* map);
 int hashMapEmptyBuckets(HashMap* map);
 float hashMapTableLoad(HashMap* map);
+size_t hashMapBytes(HashMap* map);
 void hashMapPrint(HashMap* map);
+int hashMapHistogram(HashMap* map, int* counts, int bins, double* average);
+void hashMapPrintHistogram(HashMap* map);
+void hashMapIteratorInit(HashMap* map, HashMapIterator* iterator);
+void hashMapIteratorInitShare(HashMap* map, HashMapIterator* iterator, int share,
+                              int shares);
+int hashMapIteratorNext(HashMapIterator* iterator, const char** key, int* value);
+void hashMapForEach(HashMap* map, HashMapVisit visit, void* arg, WorkerPool* pool);
+void hashMapEnableStats(HashMap* map);
+void hashMapResetStats(HashMap* map);
+void hashMapGetStats(HashMap* map, HashMapStats* stats);
+void hashMapPrintStats(HashMap* map, FILE* output);
 
 #endif
\ No newline at end of file
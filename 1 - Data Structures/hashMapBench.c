@@ -0,0 +1,485 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Hash Map Benchmark
+ * Description: Loads dictionary.txt into each Hash Map layout with each hash
+ *              function, with and without an arena, and reports the time to
+ *              build and delete the map, the average cost of a lookup that
+ *              hits and one that misses, the heap bytes the map occupies, and
+ *              how long its chains or probes are. The same is measured for a
+ *              DAWG of the words for comparison.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "hashMap.h"
+#include "genericMap.h"
+#include "wordReader.h"
+#include "dawg.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOOKUP_ROUNDS 10
+
+// Hash functions compared by the benchmark.
+static const struct
+{
+    const char* name;
+    HashFunction hash;
+} hashes[] = {
+    {"sum", hashFunction1},
+    {"weighted", hashFunction2},
+    {"fnv1a", hashFnv1a},
+    {"wy", hashWy},
+};
+
+// Print the full histogram of every map when set.
+static int verbose = 0;
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a monotonic timestamp in seconds.
+ * @return Seconds since an arbitrary fixed point.
+ ****************************************************************************/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the number of heap bytes currently in use, including large blocks
+ * malloc serves directly with mmap.
+ * @return Allocated bytes reported by malloc.
+ ****************************************************************************/
+static size_t heapInUse()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Reads every line of a file into an array of allocated strings.
+ * @param path
+ * @param count Set to the number of words read.
+ * @return Array of words or NULL if the file cannot be opened.
+ ****************************************************************************/
+static char** readWords(const char* path, int* count)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    int capacity = 1024;
+    char** words = malloc(sizeof(char*) * capacity);
+    char line[256];
+    *count = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+        {
+            continue;
+        }
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[(*count)++] = strdup(line);
+    }
+    fclose(file);
+    return words;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds a map of the given layout and hash function from the words and times
+ * its operations.
+ * @param name Label printed for the layout.
+ * @param layout
+ * @param h Index into hashes.
+ * @param arena Allocate links and keys from an arena when set.
+ * @param words
+ * @param misses Words that are not in the map.
+ * @param count Number of words and misses.
+ ****************************************************************************/
+static void benchLayout(const char* name, HashMapLayout layout, int h,
+                        int arena, char** words, char** misses, int count)
+{
+    // Time building the map from the same starting capacity spellChecker uses
+    size_t heapBefore = heapInUse();
+    double start = now();
+    HashMap* map = hashMapNewLayout(1000, layout);
+    hashMapSetHash(map, hashes[h].hash, 0);
+    if (arena)
+    {
+        hashMapUseArena(map);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        hashMapPut(map, words[i], i);
+    }
+    double build = now() - start;
+    size_t bytes = heapInUse() - heapBefore;
+
+    // Time lookups that find their key
+    long found = 0;
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += hashMapContainsKey(map, words[i]);
+        }
+    }
+    double hit = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    // Time lookups that do not find their key
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += hashMapContainsKey(map, misses[i]);
+        }
+    }
+    double miss = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    int counts[HISTOGRAM_BINS];
+    double average;
+    int longest = hashMapHistogram(map, counts, HISTOGRAM_BINS, &average);
+    if (verbose)
+    {
+        hashMapPrintHistogram(map);
+    }
+
+    // Time tearing the map down
+    start = now();
+    hashMapDelete(map);
+    double teardown = now() - start;
+
+    printf("%-8s %-9s %-5s %10.2f %10.2f %10.1f %10.1f %12zu %8.1f %10d %8.2f\n",
+           name, hashes[h].name, arena ? "arena" : "heap", build * 1e3,
+           teardown * 1e3, hit * 1e9, miss * 1e9, bytes, (double)bytes / count,
+           longest, average);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Inserts the words one at a time into a chained map and reports the slowest
+ * single hashMapPut, which is the one that triggers the largest resize unless
+ * the map resizes incrementally.
+ * @param resizeStep Old buckets moved per operation, 0 to resize all at once.
+ * @param words
+ * @param count Number of words.
+ ****************************************************************************/
+static void benchResize(int resizeStep, char** words, int count)
+{
+    HashMap* map = hashMapNew(1000);
+    hashMapSetHash(map, hashFnv1a, 0);
+    hashMapUseArena(map);
+    hashMapSetIncrementalResize(map, resizeStep);
+
+    double worst = 0;
+    double start = now();
+    for (int i = 0; i < count; i++)
+    {
+        double put = now();
+        hashMapPut(map, words[i], i);
+        put = now() - put;
+        if (put > worst)
+        {
+            worst = put;
+        }
+    }
+    double build = now() - start;
+    printf("resize step %-4d build %8.2f ms   slowest put %10.1f us\n",
+           resizeStep, build * 1e3, worst * 1e6);
+    hashMapDelete(map);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds an arena backed chained map from the words one put at a time or in
+ * bulk, and times the build and a walk over every link of the table.
+ * @param mode 0 for hashMapPut, 1 for hashMapBuildFrom, 2 for
+ *             hashMapBuildFrom sorted by bucket.
+ * @param words
+ * @param count Number of words.
+ ****************************************************************************/
+static void benchBulk(int mode, char** words, int count)
+{
+    const char* names[] = {"put", "bulk", "bulk sorted"};
+    HashMap* map = hashMapNew(1000);
+    hashMapSetHash(map, hashFnv1a, 0);
+    hashMapUseArena(map);
+
+    double start = now();
+    if (mode == 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            hashMapPut(map, words[i], i);
+        }
+    }
+    else
+    {
+        hashMapBuildFrom(map, (const char**)words, NULL, count, mode == 2);
+    }
+    double build = now() - start;
+
+    // Walk every entry the way spellCheck does
+    long length = 0;
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        HashMapIterator iterator;
+        hashMapIteratorInit(map, &iterator);
+        const char* key;
+        while (hashMapIteratorNext(&iterator, &key, NULL))
+        {
+            length += key[0];
+        }
+    }
+    double walk = (now() - start) / LOOKUP_ROUNDS;
+    printf("%-12s build %8.2f ms   walk %8.2f ms   (%ld)\n", names[mode],
+           build * 1e3, walk * 1e3, length);
+    hashMapDelete(map);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Times loading the key file the way spellChecker does: splitting it into
+ * words with a WordReader, then building an arena backed chained map from
+ * them in one pass. Line by line reading with a copy of each word is timed
+ * alongside for comparison.
+ * @param path
+ ****************************************************************************/
+static void benchLoad(const char* path)
+{
+    // Line by line, one allocation per word
+    int count;
+    double start = now();
+    char** lines = readWords(path, &count);
+    double byLine = now() - start;
+    for (int i = 0; i < count; i++)
+    {
+        free(lines[i]);
+    }
+    free(lines);
+
+    // Whole file in blocks, words sliced in place
+    start = now();
+    FILE* file = fopen(path, "r");
+    WordReader* reader = wordReaderNew(file);
+    fclose(file);
+    int capacity = 1024;
+    const char** words = malloc(sizeof(char*) * capacity);
+    count = 0;
+    const char* word;
+    while ((word = wordReaderNext(reader, NULL)) != NULL)
+    {
+        if (count == capacity)
+        {
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[count++] = word;
+    }
+    double tokenize = now() - start;
+
+    start = now();
+    HashMap* map = hashMapNew(1000);
+    hashMapSetHash(map, hashFnv1a, 0);
+    hashMapUseArena(map);
+    hashMapBuildFrom(map, words, NULL, count, 1);
+    double build = now() - start;
+
+    printf("read lines %8.2f ms   word reader %8.2f ms   build %8.2f ms\n",
+           byLine * 1e3, tokenize * 1e3, build * 1e3);
+    hashMapDelete(map);
+    free(words);
+    wordReaderDelete(reader);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds a DAWG of the words and times it like benchLayout, so its bytes per
+ * word and lookup costs line up with the maps'.
+ * @param words
+ * @param misses Words that are not in the graph.
+ * @param count Number of words and misses.
+ ****************************************************************************/
+static void benchDawg(char** words, char** misses, int count)
+{
+    size_t heapBefore = heapInUse();
+    double start = now();
+    Dawg* dawg = dawgNew((const char**)words, count);
+    double build = now() - start;
+    size_t bytes = heapInUse() - heapBefore;
+
+    long found = 0;
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += dawgContains(dawg, words[i]);
+        }
+    }
+    double hit = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += dawgContains(dawg, misses[i]);
+        }
+    }
+    double miss = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    start = now();
+    dawgDelete(dawg);
+    double teardown = now() - start;
+
+    printf("%-8s %-9s %-5s %10.2f %10.2f %10.1f %10.1f %12zu %8.1f\n", "dawg", "-", "heap",
+           build * 1e3, teardown * 1e3, hit * 1e9, miss * 1e9, bytes, (double)bytes / count);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds a generic map of string keys and int values from the words and times
+ * it like benchLayout, for comparison with the open layout it mirrors.
+ * @param words
+ * @param misses Words that are not in the map.
+ * @param count Number of words and misses.
+ ****************************************************************************/
+static void benchGeneric(char** words, char** misses, int count)
+{
+    size_t heapBefore = heapInUse();
+    double start = now();
+    GenericMap* map = genericMapNew(0, sizeof(int), 1000);
+    for (int i = 0; i < count; i++)
+    {
+        genericMapPut(map, words[i], &i);
+    }
+    double build = now() - start;
+    size_t bytes = heapInUse() - heapBefore;
+
+    long found = 0;
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += genericMapGet(map, words[i]) != NULL;
+        }
+    }
+    double hit = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    start = now();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            found += genericMapGet(map, misses[i]) != NULL;
+        }
+    }
+    double miss = (now() - start) / ((double)count * LOOKUP_ROUNDS);
+
+    start = now();
+    genericMapDelete(map);
+    double teardown = now() - start;
+
+    printf("%-8s %-9s %-5s %10.2f %10.2f %10.1f %10.1f %12zu %8.1f\n", "generic", "wy", "arena",
+           build * 1e3, teardown * 1e3, hit * 1e9, miss * 1e9, bytes, (double)bytes / count);
+}
+
+
+/*** MAIN *********************************************************************
+ * Benchmarks each layout and hash function against the key file given on the
+ * command line, or dictionary.txt by default. -v prints every histogram.
+ * @param argc
+ * @param argv
+ * @return
+ ****************************************************************************/
+int main(int argc, const char** argv)
+{
+    const char* path = "dictionary.txt";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = 1;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    int count;
+    char** words = readWords(path, &count);
+    if (words == NULL)
+    {
+        printf("cannot open %s\n", path);
+        return 1;
+    }
+
+    // Capitalized words never appear in the lowercase dictionary
+    char** misses = malloc(sizeof(char*) * count);
+    for (int i = 0; i < count; i++)
+    {
+        misses[i] = strdup(words[i]);
+        misses[i][0] = 'A' + (misses[i][0] % 26);
+    }
+
+    printf("%d words from %s\n", count, path);
+    printf("%-8s %-9s %-5s %10s %10s %10s %10s %12s %8s %10s %8s\n", "layout",
+           "hash", "alloc", "build ms", "delete ms", "hit ns", "miss ns",
+           "heap bytes", "B/word", "longest", "avg cmp");
+    for (int arena = 0; arena <= 1; arena++)
+    {
+        for (int h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+        {
+            benchLayout("chained", HASH_MAP_CHAINED, h, arena, words, misses, count);
+        }
+        // The byte sums cluster too tightly for linear probing to finish
+        for (int h = 2; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+        {
+            benchLayout("open", HASH_MAP_OPEN, h, arena, words, misses, count);
+        }
+    }
+    benchGeneric(words, misses, count);
+    benchDawg(words, misses, count);
+
+    printf("\n");
+    benchResize(0, words, count);
+    benchResize(1, words, count);
+    benchResize(4, words, count);
+
+    printf("\n");
+    for (int mode = 0; mode <= 2; mode++)
+    {
+        benchBulk(mode, words, count);
+    }
+
+    printf("\n");
+    benchLoad(path);
+
+    for (int i = 0; i < count; i++)
+    {
+        free(words[i]);
+        free(misses[i]);
+    }
+    free(words);
+    free(misses);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Levenshtein Distance
+ * Description: Computes edit distance by tracking the differences between
+ *              neighbouring cells of each column of the distance matrix as
+ *              bit vectors. One column of up to 64 cells costs a handful of
+ *              word operations instead of a cell at a time.
+ *****************************************************************************/
+
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes a pattern for a query word occupies.
+ * @param word Null terminated query.
+ * @return Size to pass to levenshteinPatternInit.
+ */
+size_t levenshteinPatternSize(const char* word)
+{
+    assert(word != NULL);
+    int blocks = (strlen(word) + LEVENSHTEIN_BLOCK - 1) / LEVENSHTEIN_BLOCK;
+    return sizeof(LevenshteinPattern) + sizeof(uint64_t) * 256 * blocks;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds the match masks of a query word in caller provided memory, so a
+ * search can keep its pattern on the stack.
+ * @param memory levenshteinPatternSize(word) bytes aligned for uint64_t.
+ * @param word Null terminated query.
+ * @return The pattern, at the start of memory.
+ */
+LevenshteinPattern* levenshteinPatternInit(void* memory, const char* word)
+{
+    assert(memory != NULL && word != NULL);
+    LevenshteinPattern* pattern = memory;
+    memset(pattern, 0, levenshteinPatternSize(word));
+    pattern->length = strlen(word);
+    pattern->blocks = (pattern->length + LEVENSHTEIN_BLOCK - 1) / LEVENSHTEIN_BLOCK;
+    for (int i = 0; i < pattern->length; i++)
+    {
+        unsigned char c = word[i];
+        pattern->peq[(i / LEVENSHTEIN_BLOCK) * 256 + c] |=
+            (uint64_t)1 << (i % LEVENSHTEIN_BLOCK);
+    }
+    return pattern;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds the match masks of a query word.
+ * @param word Null terminated query.
+ * @return The allocated pattern.
+ */
+LevenshteinPattern* levenshteinPatternNew(const char* word)
+{
+    return levenshteinPatternInit(malloc(levenshteinPatternSize(word)), word);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees a pattern.
+ * @param pattern
+ */
+void levenshteinPatternDelete(LevenshteinPattern* pattern)
+{
+    free(pattern);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Advances one block of a column by one letter of the compared word.
+ * @param pv Positive vertical differences of the block, updated.
+ * @param mv Negative vertical differences of the block, updated.
+ * @param eq Match mask of the letter for this block.
+ * @param hin Horizontal difference entering the top of the block: -1, 0 or 1.
+ * @param outBit Bit whose horizontal difference is returned.
+ * @return Horizontal difference leaving the block at outBit.
+ */
+static int advanceBlock(uint64_t* pv, uint64_t* mv, uint64_t eq, int hin,
+                        uint64_t outBit)
+{
+    uint64_t hinNegative = hin < 0;
+    uint64_t xv = eq | *mv;
+    eq |= hinNegative;
+    uint64_t xh = (((eq & *pv) + *pv) ^ *pv) | eq;
+    uint64_t ph = *mv | ~(xh | *pv);
+    uint64_t mh = *pv & xh;
+
+    int hout = 0;
+    if (ph & outBit)
+    {
+        hout = 1;
+    }
+    else if (mh & outBit)
+    {
+        hout = -1;
+    }
+
+    // Shift the horizontal differences down a row, bringing in hin at the top
+    ph = (ph << 1) | (uint64_t)(hin > 0);
+    mh = (mh << 1) | hinNegative;
+    *pv = mh | ~(xv | ph);
+    *mv = ph & xv;
+    return hout;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the edit distance between the pattern's query and a word, or any
+ * value greater than limit once the distance is known to exceed limit.
+ * @param pattern
+ * @param word Null terminated word to compare.
+ * @param limit Largest distance of interest.
+ * @return Edit distance, or a value greater than limit.
+ */
+int levenshteinDistanceBounded(const LevenshteinPattern* pattern,
+                               const char* word, int limit)
+{
+    assert(pattern != NULL && word != NULL);
+    int length = strlen(word);
+    int m = pattern->length;
+
+    // The distance is at least the difference in length
+    if (m - length > limit || length - m > limit)
+    {
+        return limit + 1;
+    }
+    if (m == 0)
+    {
+        return length;
+    }
+
+    // Vertical differences of the first column are all +1
+    uint64_t pv[pattern->blocks];
+    uint64_t mv[pattern->blocks];
+    for (int b = 0; b < pattern->blocks; b++)
+    {
+        pv[b] = ~(uint64_t)0;
+        mv[b] = 0;
+    }
+    uint64_t lastBit = (uint64_t)1 << ((m - 1) % LEVENSHTEIN_BLOCK);
+    uint64_t highBit = (uint64_t)1 << (LEVENSHTEIN_BLOCK - 1);
+    int last = pattern->blocks - 1;
+
+    // score is the bottom cell of the current column
+    int score = m;
+    for (int j = 0; j < length; j++)
+    {
+        const uint64_t* eq = pattern->peq + (unsigned char)word[j];
+        int carry = 1;
+        for (int b = 0; b < last; b++)
+        {
+            carry = advanceBlock(&pv[b], &mv[b], eq[b * 256], carry, highBit);
+        }
+        score += advanceBlock(&pv[last], &mv[last], eq[last * 256], carry, lastBit);
+
+        // Each remaining letter lowers the score by at most one
+        if (score - (length - j - 1) > limit)
+        {
+            return limit + 1;
+        }
+    }
+    return score;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the edit distance between the pattern's query and a word.
+ * @param pattern
+ * @param word Null terminated word to compare.
+ * @return Edit distance.
+ */
+int levenshteinDistance(const LevenshteinPattern* pattern, const char* word)
+{
+    return levenshteinDistanceBounded(pattern, word, pattern->length + strlen(word));
+}
@@ -0,0 +1,40 @@
+#ifndef LEVENSHTEIN_H
+#define LEVENSHTEIN_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Levenshtein Distance
+ * Description: Header file for a bit-parallel edit distance engine (Myers'
+ *              algorithm as formulated by Hyyrö). A query word is turned into
+ *              a pattern once, then compared against many words 64 letters
+ *              of the query at a time.
+ *****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Letters of the query handled per machine word.
+#define LEVENSHTEIN_BLOCK 64
+
+typedef struct LevenshteinPattern LevenshteinPattern;
+
+struct LevenshteinPattern
+{
+    // Length of the query word.
+    int length;
+    // Number of LEVENSHTEIN_BLOCK letter blocks the query spans.
+    int blocks;
+    // For block b and byte c, bit i of peq[b * 256 + c] is set when letter
+    // b * LEVENSHTEIN_BLOCK + i of the query is c.
+    uint64_t peq[];
+};
+
+size_t levenshteinPatternSize(const char* word);
+LevenshteinPattern* levenshteinPatternInit(void* memory, const char* word);
+LevenshteinPattern* levenshteinPatternNew(const char* word);
+void levenshteinPatternDelete(LevenshteinPattern* pattern);
+int levenshteinDistance(const LevenshteinPattern* pattern, const char* word);
+int levenshteinDistanceBounded(const LevenshteinPattern* pattern,
+                               const char* word, int limit);
+
+#endif
@@ -0,0 +1,491 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Line Server
+ * Description: Level triggered epoll loop over non-blocking sockets. Each
+ *              connection buffers what it has received and the replies it
+ *              owes, answers every whole line it holds, and writes as much
+ *              as the socket takes. SIGINT or SIGTERM stops the loop.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lineServer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Set by the signal handler to stop lineServerRun.
+static volatile sig_atomic_t stopping;
+
+/*** IMPLEMENT ***************************************************************
+ * Asks the server loop to stop.
+ * @param number Signal number, unused.
+ */
+static void stopServer(int number)
+{
+    stopping = 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Makes a file descriptor's reads and writes return instead of blocking.
+ * @param fd
+ * @return 0, or -1 on failure.
+ */
+static int setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Appends a reply and its newline to a connection's unsent output.
+ * @param connection
+ * @param reply
+ */
+static void appendReply(LineConnection* connection, const char* reply)
+{
+    size_t length = strlen(reply);
+    if (connection->outputLength + length + 1 > connection->outputCapacity)
+    {
+        // Drop what has been sent before growing
+        memmove(connection->output, connection->output + connection->outputSent,
+                connection->outputLength - connection->outputSent);
+        connection->outputLength -= connection->outputSent;
+        connection->outputSent = 0;
+        while (connection->outputLength + length + 1 > connection->outputCapacity)
+        {
+            connection->outputCapacity *= 2;
+        }
+        connection->output = realloc(connection->output, connection->outputCapacity);
+    }
+    memcpy(connection->output + connection->outputLength, reply, length);
+    connection->output[connection->outputLength + length] = '\n';
+    connection->outputLength += length + 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Answers the whole lines a connection has received, in order, until its
+ * unsent replies reach LINE_SERVER_BACKLOG. Once the client has finished
+ * sending, a last line without a newline is answered too.
+ * @param connection
+ * @param handler
+ * @param arg
+ */
+static void answerLines(LineConnection* connection, LineHandler handler, void* arg)
+{
+    size_t start = 0;
+    while (connection->outputLength - connection->outputSent < LINE_SERVER_BACKLOG)
+    {
+        char* line = connection->input + start;
+        size_t left = connection->inputLength - start;
+        char* end = memchr(line, '\n', left);
+        if (end == NULL)
+        {
+            if (!connection->finished || left == 0)
+            {
+                break;
+            }
+            end = line + left;
+        }
+        *end = '\0';
+        if (end > line && end[-1] == '\r')
+        {
+            end[-1] = '\0';
+        }
+        appendReply(connection, handler(line, arg));
+
+        // Continue after the newline, or at the end if the line had none
+        start = end - connection->input;
+        if (start < connection->inputLength)
+        {
+            start++;
+        }
+    }
+
+    // Keep the unanswered bytes at the front of the buffer
+    memmove(connection->input, connection->input + start, connection->inputLength - start);
+    connection->inputLength -= start;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns whether a connection holds a line answerLines would answer.
+ * @param connection
+ * @return 1 if a whole line, or a last line the client finished without a
+ *         newline, is waiting.
+ */
+static int hasLine(LineConnection* connection)
+{
+    if (connection->finished && connection->inputLength > 0)
+    {
+        return 1;
+    }
+    return memchr(connection->input, '\n', connection->inputLength) != NULL;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Checks the bytes just received for a line longer than LINE_SERVER_LINE_MAX,
+ * newline included, carrying the length of an unfinished line over to the
+ * next read.
+ * @param connection
+ * @param from Offset of the first new byte in the input buffer.
+ * @return 0, or -1 if a line is too long.
+ */
+static int checkLines(LineConnection* connection, size_t from)
+{
+    char* start = connection->input + from;
+    char* end = connection->input + connection->inputLength;
+    while (start < end)
+    {
+        char* newline = memchr(start, '\n', end - start);
+        size_t length = (newline != NULL ? newline : end) - start;
+        if (connection->lineLength + length >= LINE_SERVER_LINE_MAX)
+        {
+            return -1;
+        }
+        if (newline == NULL)
+        {
+            connection->lineLength += length;
+            break;
+        }
+        connection->lineLength = 0;
+        start = newline + 1;
+    }
+    return 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Reads what a connection has received, without blocking, until the socket
+ * is drained or the input buffer is full.
+ * @param connection
+ * @return 0, or -1 if the connection failed or sent an over long line.
+ */
+static int readInput(LineConnection* connection)
+{
+    while (connection->inputLength < LINE_SERVER_READ_SIZE)
+    {
+        ssize_t count = read(connection->fd, connection->input + connection->inputLength,
+                             LINE_SERVER_READ_SIZE - connection->inputLength);
+        if (count > 0)
+        {
+            connection->inputLength += count;
+            if (checkLines(connection, connection->inputLength - count) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (count == 0)
+        {
+            connection->finished = 1;
+            return 0;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        else if (errno != EINTR)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Writes a connection's unsent replies until they are all sent or the socket
+ * is full.
+ * @param connection
+ * @return 0, or -1 if the connection failed.
+ */
+static int writeOutput(LineConnection* connection)
+{
+    while (connection->outputSent < connection->outputLength)
+    {
+        ssize_t count = send(connection->fd, connection->output + connection->outputSent,
+                             connection->outputLength - connection->outputSent, MSG_NOSIGNAL);
+        if (count >= 0)
+        {
+            connection->outputSent += count;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        else if (errno != EINTR)
+        {
+            return -1;
+        }
+    }
+    connection->outputSent = 0;
+    connection->outputLength = 0;
+    return 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Closes a connection and frees its buffers.
+ * @param connections Head of the connection list, updated.
+ * @param connection
+ */
+static void closeConnection(LineConnection** connections, LineConnection* connection)
+{
+    if (connection->prev != NULL)
+    {
+        connection->prev->next = connection->next;
+    }
+    else
+    {
+        *connections = connection->next;
+    }
+    if (connection->next != NULL)
+    {
+        connection->next->prev = connection->prev;
+    }
+    close(connection->fd);
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Accepts every pending connection and registers it with epoll. When the
+ * process is out of file descriptors, the spare one is given up to accept
+ * and close the connection, which would otherwise stay queued and wake the
+ * level triggered listener again at once.
+ * @param listener Listening socket.
+ * @param epoll
+ * @param connections Head of the connection list, updated.
+ * @param spare Descriptor kept open for running out, or -1, updated.
+ */
+static void acceptConnections(int listener, int epoll, LineConnection** connections,
+                              int* spare)
+{
+    while (1)
+    {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && *spare >= 0)
+            {
+                // accept fails this way even with nothing queued, so stop
+                // once the spare descriptor finds nothing to drop
+                close(*spare);
+                fd = accept(listener, NULL, NULL);
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                *spare = open("/dev/null", O_RDONLY);
+                if (fd < 0)
+                {
+                    return;
+                }
+                continue;
+            }
+            return;
+        }
+        if (setNonBlocking(fd) != 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        LineConnection* connection = malloc(sizeof(LineConnection));
+        connection->fd = fd;
+        // One spare byte terminates a last line sent without a newline
+        connection->input = malloc(LINE_SERVER_READ_SIZE + 1);
+        connection->inputLength = 0;
+        connection->lineLength = 0;
+        connection->outputCapacity = 4096;
+        connection->output = malloc(connection->outputCapacity);
+        connection->outputLength = 0;
+        connection->outputSent = 0;
+        connection->finished = 0;
+        connection->events = EPOLLIN;
+        connection->prev = NULL;
+        connection->next = *connections;
+        if (*connections != NULL)
+        {
+            (*connections)->prev = connection;
+        }
+        *connections = connection;
+
+        struct epoll_event event;
+        event.events = connection->events;
+        event.data.ptr = connection;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Handles epoll reporting a connection ready: reads what it can, then answers
+ * and writes until the socket is full or no line is left, then registers for reading while the backlog has room and for
+ * writing while replies are unsent. A connection is closed once the client
+ * has finished and every reply is sent, or when it fails.
+ * @param epoll
+ * @param connections Head of the connection list, updated.
+ * @param connection
+ * @param events Events epoll reported.
+ * @param handler
+ * @param arg
+ */
+static void serveConnection(int epoll, LineConnection** connections, LineConnection* connection,
+                            unsigned int events, LineHandler handler, void* arg)
+{
+    int failed = 0;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+        failed = readInput(connection);
+    }
+    // Lines held back by the backlog wait for no new input, so keep
+    // answering while the socket takes every reply
+    while (!failed)
+    {
+        answerLines(connection, handler, arg);
+        failed = writeOutput(connection);
+        if (connection->outputLength > 0 || !hasLine(connection))
+        {
+            break;
+        }
+    }
+    size_t unsent = connection->outputLength - connection->outputSent;
+    if (failed || (connection->finished && connection->inputLength == 0 && unsent == 0))
+    {
+        closeConnection(connections, connection);
+        return;
+    }
+
+    unsigned int wanted = 0;
+    if (unsent < LINE_SERVER_BACKLOG && !connection->finished)
+    {
+        wanted |= EPOLLIN;
+    }
+    if (unsent > 0)
+    {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted != connection->events)
+    {
+        struct epoll_event event;
+        event.events = wanted;
+        event.data.ptr = connection;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = wanted;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Listens on a Unix domain socket and answers each line clients send with
+ * the line handler returns, until SIGINT or SIGTERM. A stale socket file at
+ * path is replaced, and the file is removed when the server stops.
+ * @param path Socket file.
+ * @param handler Called with each request line.
+ * @param arg Passed to handler.
+ * @return 0 once stopped, or -1 if the socket could not be set up.
+ */
+int lineServerRun(const char* path, LineHandler handler, void* arg)
+{
+    assert(path != NULL && handler != NULL);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        return -1;
+    }
+    unlink(path);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0 || setNonBlocking(listener) != 0)
+    {
+        close(listener);
+        return -1;
+    }
+    int epoll = epoll_create1(0);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+    // Stop on a signal, letting epoll_pwait return early instead of restarting.
+    // The signals stay blocked outside the wait, so one cannot arrive between
+    // checking stopping and waiting.
+    struct sigaction action;
+    struct sigaction oldInterrupt;
+    struct sigaction oldTerminate;
+    sigset_t stopSignals;
+    sigset_t waitMask;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer;
+    sigemptyset(&action.sa_mask);
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &waitMask);
+    sigaction(SIGINT, &action, &oldInterrupt);
+    sigaction(SIGTERM, &action, &oldTerminate);
+    stopping = 0;
+
+    LineConnection* connections = NULL;
+    struct epoll_event events[LINE_SERVER_EVENTS];
+    int spare = open("/dev/null", O_RDONLY);
+    while (!stopping)
+    {
+        int count = epoll_pwait(epoll, events, LINE_SERVER_EVENTS, -1, &waitMask);
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.ptr == NULL)
+            {
+                acceptConnections(listener, epoll, &connections, &spare);
+            }
+            else
+            {
+                serveConnection(epoll, &connections, events[i].data.ptr, events[i].events,
+                                handler, arg);
+            }
+        }
+    }
+
+    while (connections != NULL)
+    {
+        closeConnection(&connections, connections);
+    }
+    pthread_sigmask(SIG_SETMASK, &waitMask, NULL);
+    sigaction(SIGINT, &oldInterrupt, NULL);
+    sigaction(SIGTERM, &oldTerminate, NULL);
+    if (spare >= 0)
+    {
+        close(spare);
+    }
+    close(epoll);
+    close(listener);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef LINE_SERVER_H
+#define LINE_SERVER_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Line Server
+ * Description: Header file for a single threaded server that answers
+ *              newline terminated requests on a Unix domain socket. One epoll
+ *              loop watches every connection, and a client may send many
+ *              requests without waiting; their replies come back in order.
+ *****************************************************************************/
+
+#include <stddef.h>
+
+// Longest request line, newline included. Longer lines close the connection.
+#define LINE_SERVER_LINE_MAX 4096
+// Bytes read from a connection at a time.
+#define LINE_SERVER_READ_SIZE (64 * 1024)
+// A connection with this many reply bytes unsent is not read from until the
+// client catches up.
+#define LINE_SERVER_BACKLOG (1024 * 1024)
+// Events taken from epoll per wait.
+#define LINE_SERVER_EVENTS 64
+
+typedef struct LineConnection LineConnection;
+
+// Answers one request. line has no newline and may be modified. Returns the
+// reply without its newline, which must stay valid until the next call.
+typedef const char* (*LineHandler)(char* line, void* arg);
+
+struct LineConnection
+{
+    int fd;
+    // Bytes received and not yet answered.
+    char* input;
+    size_t inputLength;
+    // Bytes of the last line received that are not followed by a newline.
+    size_t lineLength;
+    // Replies not yet sent, the first outputSent of them already written.
+    char* output;
+    size_t outputLength;
+    size_t outputSent;
+    size_t outputCapacity;
+    // Set once the client has finished sending.
+    int finished;
+    // Events the connection is registered with epoll for.
+    unsigned int events;
+    // Every open connection, so they can be closed when the server stops.
+    LineConnection* prev;
+    LineConnection* next;
+};
+
+int lineServerRun(const char* path, LineHandler handler, void* arg);
+
+#endif
@@ -10,79 +10,102 @@
  *              words they may have meant to type utilizing the Levenshtein Distance.
  *****************************************************************************/
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "hashMap.h"
+#include "genericMap.h"
+#include "wordReader.h"
+#include "levenshtein.h"
+#include "bkTree.h"
+#include "dawg.h"
+#include "symSpell.h"
+#include "workerPool.h"
+#include "lineServer.h"
+#include "suggestionCache.h"
 #include <assert.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
 
-/*** HELPER CODE *************************************************************
- * Allocates a string for the next word in the file and returns it. This string
- * is null terminated. Returns NULL after reaching the end of the file.
- * @param file
- * @return Allocated string or NULL.
- ****************************************************************************/
-char* nextWord(FILE* file)
+// Optional suggestion indexes built alongside the dictionary map.
+typedef struct Indexes
 {
-    int maxLength = 16;
-    int length = 0;
-    char* word = malloc(sizeof(char) * maxLength);
-    while (1)
-    {
-        char c = fgetc(file);
-        if ((c >= '0' && c <= '9') ||
-            (c >= 'A' && c <= 'Z') ||
-            (c >= 'a' && c <= 'z') ||
-            c == '\'')
-        {
-            if (length + 1 >= maxLength)
-            {
-                maxLength *= 2;
-                word = realloc(word, maxLength);
-            }
-            word[length] = c;
-            length++;
-        }
-        else if (length > 0 || c == EOF)
-        {
-            break;
-        }
-    }
-    if (length == 0)
-    {
-        free(word);
-        return NULL;
-    }
-    word[length] = '\0';
-    return word;
-}
-
+    BkTree* tree;
+    // Word graph answering membership and suggestions in place of the map,
+    // or NULL.
+    Dawg* dawg;
+    // Build dawg while loading.
+    int useDawg;
+    SymSpell* symSpell;
+    // Edit distance to build symSpell for, or 0 to not build it.
+    int symSpellDistance;
+    // Suggestions for recent misspellings, or NULL.
+    SuggestionCache* cache;
+} Indexes;
 
 /*** IMPLEMENT ***************************************************************
- * Loads the contents of dictionary.txt into the HashMap ADT.
+ * Loads the contents of dictionary.txt into the HashMap ADT. The file is split
+ * into words in place and then built into the map in one pass, so the table
+ * is sized once and each word is copied only into the map.
  * @param file
  * @param map
+ * @param indexes Every word is also added to indexes->tree if there is one,
+ *                and indexes->dawg and indexes->symSpell are built if asked
+ *                for.
  ****************************************************************************/
-void loadDictionary(FILE* file, HashMap* map)
+void loadDictionary(FILE* file, HashMap* map, Indexes* indexes)
 {
-    assert(file != NULL && map != NULL);
-    
-    // Asssign word to first word & set starting value to 0 for all words
-    char* word = nextWord(file);
-    int distance = 0;
+    assert(file != NULL && map != NULL && indexes != NULL);
 
-    // Loop until end of file is reached
+    // Read the whole file, words are sliced out of the reader's buffer
+    WordReader* reader = wordReaderNew(file);
+
+    // Create a growable array for the words
+    int capacity = 1024;
+    int count = 0;
+    const char** words = malloc(sizeof(char*) * capacity);
+
+    // Loop until end of file is reached, collecting every word
+    const char* word = wordReaderNext(reader, NULL);
     while(word != NULL)
     {
-        // Put word in map with distance value of 0
-        hashMapPut(map, word, distance);
-        
-        // Free word and assign word to next word
-        free(word);
-        word = nextWord(file);
+        if(count == capacity)
+        {
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[count++] = word;
+        word = wordReaderNext(reader, NULL);
+    }
+
+    // Put every word in map with distance value of 0, grouped by bucket
+    hashMapBuildFrom(map, words, NULL, count, 1);
+
+    // Index the words for suggestion queries
+    if(indexes->tree != NULL)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            bkTreeAdd(indexes->tree, words[i]);
+        }
+    }
+    if(indexes->useDawg)
+    {
+        indexes->dawg = dawgNew(words, count);
+    }
+    if(indexes->symSpellDistance > 0)
+    {
+        indexes->symSpell = symSpellNew(words, count, indexes->symSpellDistance,
+                                        SYM_SPELL_PREFIX);
     }
+
+    // Free the word list and buffer now that the map holds its own copies
+    free(words);
+    wordReaderDelete(reader);
 }
 
 
@@ -111,179 +134,689 @@ int isWord(const char* userInput)
 
 
 /*** IMPLEMENT ***************************************************************
- * Calculates the Levenshtein Distance between the user's word and each word in
- * the dictionary.
+ * Returns whether a word is in the dictionary, asking the word graph instead
+ * of the map if there is one.
+ * @param map Dictionary.
+ * @param indexes
+ * @param word Lowercase word.
+ * @return 1 if the word is spelled correctly, 0 otherwise.
+ ****************************************************************************/
+int inDictionary(HashMap* map, Indexes* indexes, const char* word)
+{
+    if(indexes->dawg != NULL)
+    {
+        return dawgContains(indexes->dawg, word);
+    }
+    return hashMapContainsKey(map, word);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints a word completed by the word graph.
+ * @param word
+ * @param arg Number of words printed so far.
+ ****************************************************************************/
+void printCompletion(const char* word, void* arg)
+{
+    int* printed = arg;
+    printf("%s%s", (*printed)++ == 0 ? "" : ", ", word);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Calculates the Levenshtein Distance between the user's word and a word in
+ * the dictionary, without allocating. spellCheck compares many words against
+ * one user word, so it builds the user word's pattern once and calls
+ * levenshtein.c directly.
  * @param usrWord user input
  * @param mapWord word from dictionary
  * @return Levenshtein Distance between the two words
  ****************************************************************************/
 int calcDistance(const char* usrWord, const char* mapWord)
 {
-    // Get the length of both words plus one for matrix dimensions and declare matrix
-    int usrLen = strlen(usrWord) + 1;
-    int mapLen = strlen(mapWord) + 1;
-    int distance[usrLen][mapLen];
-    
-    // Initialize loop variables
-    int i;
-    int j;
-    // Assign all indices of matrix to 0
-    for(i = 0; i < usrLen; i++) 
+    // Build the user word's masks on the stack and compare the dictionary word
+    // against them
+    uint64_t memory[(levenshteinPatternSize(usrWord) + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+    return levenshteinDistance(levenshteinPatternInit(memory, usrWord), mapWord);
+}
+
+
+// A spellCheck split across the workers of a pool. Each worker scans a
+// share of the buckets into a heap of its own.
+typedef struct ScanJob
+{
+    HashMap* map;
+    const LevenshteinPattern* pattern;
+    int k;
+    // k suggestions for each worker, and how many each holds.
+    Suggestion* heaps;
+    int* counts;
+    // Lowest limit any worker has reached. A worker's worst of k bounds the
+    // final worst of k, so every worker can stop comparisons past it.
+    int limit;
+} ScanJob;
+
+/*** IMPLEMENT ***************************************************************
+ * Scans one worker's share of the dictionary, in the order its words lie in
+ * the table.
+ * @param arg ScanJob.
+ * @param worker
+ * @param workers
+ ****************************************************************************/
+static void scanTask(void* arg, int worker, int workers)
+{
+    ScanJob* job = arg;
+    HashMap* map = job->map;
+    int k = job->k;
+    Suggestion* heap = job->heaps + (long)worker * k;
+    int count = 0;
+    int limit = __atomic_load_n(&job->limit, __ATOMIC_RELAXED);
+
+    // Offer each word of the share to the top k
+    HashMapIterator iterator;
+    hashMapIteratorInitShare(map, &iterator, worker, workers);
+    const char* key;
+    while(hashMapIteratorNext(&iterator, &key, NULL))
     {
-        for(j = 0; j < mapLen; j++)
+        int shared = __atomic_load_n(&job->limit, __ATOMIC_RELAXED);
+        if(shared < limit)
         {
-            distance[i][j] = 0;
+            limit = shared;
+        }
+        int distance = levenshteinDistanceBounded(job->pattern, key, limit);
+        if(distance > limit)
+        {
+            continue;
+        }
+        count = suggestionOffer(heap, count, k, key, distance);
+        int lower = suggestionLimit(heap, count, k, limit);
+        if(lower < limit)
+        {
+            // Share the lower limit unless another worker got lower
+            limit = lower;
+            while(limit < shared &&
+                  !__atomic_compare_exchange_n(&job->limit, &shared, limit, 1,
+                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+            }
         }
     }
-    
-    // Add the cost of adding/dropping each letter across first row & down first column
-    for(i = 1; i <= usrLen; i++)
+    job->counts[worker] = count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Loops through the dictionary and calculates the Levenshtein Distance between
+ * each word and the user's word. The k words with the lowest distances, ties
+ * broken alphabetically, are suggestions for the misspelled word. The map is
+ * only read and nothing is allocated, so several queries may scan one map at
+ * once. With a pool, each worker scans a share of the buckets with its own
+ * top k and the shares are merged.
+ * @param map Dictionary words, in any layout.
+ * @param usrWord user input
+ * @param k Number of suggestions wanted.
+ * @param results Array of at least k suggestions, filled closest first.
+ * @param pool Workers to split the scan across, or NULL to scan on this thread.
+ * @return Number of suggestions found, k unless the dictionary is smaller.
+ ****************************************************************************/
+int spellCheck(HashMap* map, const char* usrWord, int k, Suggestion* results,
+               WorkerPool* pool)
+{
+    assert(map != NULL);
+
+    // Precompute the user word's masks once for every comparison, on the stack
+    uint64_t memory[(levenshteinPatternSize(usrWord) + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+    LevenshteinPattern* pattern = levenshteinPatternInit(memory, usrWord);
+
+    // Scan straight into results when there is only one worker
+    int workers = pool != NULL ? pool->workers : 1;
+    if(workers == 1)
     {
-        distance[i][0] = i;
+        int count;
+        ScanJob job = {map, pattern, k, results, &count, INT_MAX - 1};
+        scanTask(&job, 0, 1);
+        suggestionSort(results, count);
+        return count;
     }
-    for(j = 1; j < mapLen; j++)
+
+    // Scan in parallel, then merge every worker's top k. k comes from the
+    // user, so the heaps go on the heap rather than the stack
+    Suggestion* heaps = malloc(sizeof(Suggestion) * workers * (size_t)k);
+    int* counts = malloc(sizeof(int) * workers);
+    ScanJob job = {map, pattern, k, heaps, counts, INT_MAX - 1};
+    workerPoolRun(pool, scanTask, &job);
+    int count = 0;
+    for(int w = 0; w < workers; w++)
     {
-        distance[0][j] = j;
+        for(int i = 0; i < counts[w]; i++)
+        {
+            count = suggestionOffer(results, count, k, heaps[(long)w * k + i].word,
+                                    heaps[(long)w * k + i].distance);
+        }
     }
+    free(heaps);
+    free(counts);
+    suggestionSort(results, count);
+    return count;
+}
+
 
-    //Loop through remainder of matrix to calculate the cost of substitution, adding, or deleting 
-    for(i = 1; i < usrLen; i++)
+/*** IMPLEMENT ***************************************************************
+ * Finds the k closest dictionary words to a misspelled word, asking the
+ * cache, then the delete index, then the word graph or BK-tree, then
+ * scanning the whole dictionary, until one of them finds k. The delete index only knows words
+ * within its distance, so it can come up short.
+ * @param map Dictionary.
+ * @param indexes
+ * @param pool Workers to scan with, or NULL.
+ * @param word Lowercase misspelled word.
+ * @param k Number of suggestions wanted.
+ * @param results Array of at least k suggestions, filled closest first.
+ * @return Number of suggestions found.
+ ****************************************************************************/
+int suggest(HashMap* map, Indexes* indexes, WorkerPool* pool, const char* word,
+            int k, Suggestion* results)
+{
+    // Repeated misspellings are answered without a search
+    if(indexes->cache != NULL)
     {
-        for(j = 1; j < mapLen; j++)
+        int cached = suggestionCacheGet(indexes->cache, word, results);
+        if(cached >= 0)
         {
-            int subCost = 0;
-            // If the two letters at the given index are not equal
-            if(usrWord[i - 1] != mapWord[j - 1])
-            {
-                // Set subCost to 1
-                subCost = 1;
-            }
-            
-            // Calculate the cost of substituting, adding, and removing a letter
-            int sub = distance[i - 1][j - 1] + subCost;
-            int add = distance[i][j - 1] + 1;
-            int rmv = distance[i - 1][j] + 1;
-            
-            //Set the value of the index to the minimum of substituting, adding, or removing
-            if(sub <= rmv && sub <= add)
-            {
-                distance[i][j] = sub;
-            }
-            else if(add <= sub && add <= rmv)
-            {
-                distance[i][j] = add;
-            }
-            else
-            {
-                distance[i][j] = rmv;
-            }
+            return cached;
         }
     }
 
-    // The Levenshtein Distance equals the value located at the last row, last col index
-    return distance[usrLen - 1][mapLen - 1];
+    int found = 0;
+    if(indexes->symSpell != NULL)
+    {
+        found = symSpellQuery(indexes->symSpell, word, k, results);
+    }
+    if(found < k && indexes->dawg != NULL)
+    {
+        found = dawgQuery(indexes->dawg, word, k, strlen(word), results);
+    }
+    if(found < k && indexes->tree != NULL)
+    {
+        found = bkTreeQuery(indexes->tree, word, k, strlen(word), results);
+    }
+    if(found < k)
+    {
+        //Calculate the Levenshtein Distance of all words
+        found = spellCheck(map, word, k, results, pool);
+    }
+    if(indexes->cache != NULL)
+    {
+        suggestionCachePut(indexes->cache, word, results, found);
+    }
+    return found;
 }
 
 
 /*** IMPLEMENT ***************************************************************
- * Loops through the dictionary and calculate the Levenshtein Distance between
- * each word and the user's word. Five words with the lowest differences are
- * suggestions for misspelled word and returned to caller.
- * @param map
- * @param altWords array of HashLinks
- * @param usrWord user input
- * @return altWords, an array of 5 alternate words
+ * Joins suggestions into one comma separated string.
+ * @param results
+ * @param found Number of suggestions.
+ * @return The allocated string, empty if there are no suggestions.
  ****************************************************************************/
-void spellCheck(HashMap* map, HashLink** altWords, const char* usrWord)
+char* joinSuggestions(const Suggestion* results, int found)
 {
-    // Set max to 0 and count to 0
-    int max = 0;
-    int count = 0;
+    size_t size = 1;
+    for(int r = 0; r < found; r++)
+    {
+        size += strlen(results[r].word) + 1;
+    }
+    char* line = malloc(size);
+    line[0] = '\0';
+    for(int r = 0; r < found; r++)
+    {
+        if(r > 0)
+        {
+            strcat(line, ",");
+        }
+        strcat(line, results[r].word);
+    }
+    return line;
+}
 
-    // Loop over each bucket
-    int i;
-    for(i = 0; i < map->capacity; i++)
+
+/*** IMPLEMENT ***************************************************************
+ * Spell checks a whole document, streaming it through a WordReader so its
+ * size does not matter. Words are lowercased and stripped of surrounding
+ * apostrophes; words with digits are skipped and a possessive 's is accepted
+ * if the rest of the word is in the dictionary. Each misspelled word is
+ * written as one tab separated line:
+ *     word  byte offset  suggestion,suggestion,...
+ * Suggestions are computed once per distinct misspelling and reused.
+ * @param input Document to check.
+ * @param output Where the misspellings are written.
+ * @param map Dictionary.
+ * @param indexes
+ * @param pool Workers to scan with, or NULL.
+ * @param k Number of suggestions per misspelling.
+ * @param results Array of at least k suggestions to use as scratch.
+ ****************************************************************************/
+void checkDocument(FILE* input, FILE* output, HashMap* map, Indexes* indexes,
+                   WorkerPool* pool, int k, Suggestion* results)
+{
+    // Suggestion line of each misspelling already seen, stored in its slot
+    GenericMap* cache = genericMapNew(0, sizeof(char*), 1000);
+
+    WordReader* reader = wordReaderStream(input);
+    long long words = 0;
+    long long misspelled = 0;
+    char lower[256];
+    int length;
+    char* word;
+    while((word = wordReaderNext(reader, &length)) != NULL)
     {
-        //Create helper HashLink ptr to hold current link
-        HashLink* curLink = map->table[i];
+        long long offset = reader->offset;
 
-        // Traverse the bucket until link is NULL...
-        while(curLink != NULL)
+        // Strip quotes around the word
+        while(length > 0 && word[0] == '\'')
         {
-            // Replace current key's value with the Levenshtein Distance
-            hashMapPut(map, curLink->key, calcDistance(usrWord, curLink->key));
-            
-            // If five words are not in the array...
-            if(count < 5)
-            {
-                // Add word to first available index and incremnent count
-                altWords[count++] = curLink;
+            word++;
+            length--;
+            offset++;
+        }
+        while(length > 0 && word[length - 1] == '\'')
+        {
+            word[--length] = '\0';
+        }
+        if(length == 0 || length >= (int)sizeof(lower))
+        {
+            continue;
+        }
 
-                // If the distance is greater than the max, set max to value
-                if(curLink->value > max)
-                {
-                    max = curLink->value;
-                }
-            }
-            // Else, the array is full and if the curLink value is less than max...
-            else if(curLink->value < max)
+        // Lowercase the word, skipping numbers and words with digits
+        int digits = 0;
+        for(int i = 0; i <= length; i++)
+        {
+            lower[i] = tolower((unsigned char)word[i]);
+            digits |= isdigit((unsigned char)word[i]);
+        }
+        if(digits)
+        {
+            continue;
+        }
+        words++;
+
+        // Accept dictionary words and their possessives
+        if(inDictionary(map, indexes, lower))
+        {
+            continue;
+        }
+        if(length > 2 && strcmp(lower + length - 2, "'s") == 0)
+        {
+            lower[length - 2] = '\0';
+            int found = inDictionary(map, indexes, lower);
+            lower[length - 2] = '\'';
+            if(found)
             {
-                // Find the HashLink with the max value and replace it with curLink
-                int index = 0;
-                int replaced = 0;
-                while(index < count && !replaced)
-                {
-                    if(altWords[index]->value == max)
-                    {
-                        altWords[index] = curLink;
-                        replaced = 1;
-                    }
-                    index++;
-                }
-                // Create loop control, reset max value, and recalculate
-                int j;
-                max = 0;
-                for(j = 0; j < count; j++)
-                {
-                    if(altWords[j]->value > max)
-                    {
-                        max = altWords[j]->value;
-                    }
-                }
+                continue;
             }
-            // Traverse to next link in bucket
-            curLink = curLink->next;
         }
+        misspelled++;
+
+        // Suggest once per distinct misspelling, one search finding or adding it
+        int added;
+        char** line = genericMapFindOrAdd(cache, lower, &added);
+        if(added)
+        {
+            int found = suggest(map, indexes, pool, lower, k, results);
+            *line = joinSuggestions(results, found);
+        }
+        fprintf(output, "%s\t%lld\t%s\n", word, offset, *line);
+    }
+
+    fprintf(stderr, "%lld words checked, %lld misspelled, %d distinct misspellings\n",
+            words, misspelled, genericMapSize(cache));
+    wordReaderDelete(reader);
+    void* line;
+    for(int i = genericMapNext(cache, -1, NULL, &line); i >= 0;
+        i = genericMapNext(cache, i, NULL, &line))
+    {
+        free(*(char**)line);
     }
+    genericMapDelete(cache);
+}
+
+
+// Everything a server request is answered from.
+typedef struct Server
+{
+    HashMap* map;
+    Indexes* indexes;
+    WorkerPool* pool;
+    int k;
+    Suggestion* results;
+    // Last reply, kept until the next request.
+    char* reply;
+} Server;
+
+/*** IMPLEMENT ***************************************************************
+ * Answers one request to the spell check server. A request is a command and
+ * a word separated by a space:
+ *     check word    ok if the word is spelled correctly, otherwise miss and
+ *                   the comma separated suggestions
+ *     suggest word  the comma separated suggestions
+ * Anything else is answered with error and a reason.
+ * @param line Request without its newline.
+ * @param arg Server.
+ * @return Reply without its newline.
+ ****************************************************************************/
+const char* answerRequest(char* line, void* arg)
+{
+    Server* server = arg;
+    char* word = strchr(line, ' ');
+    if(word == NULL)
+    {
+        return "error expected a command and a word";
+    }
+    *word++ = '\0';
+    for(int i = 0; word[i]; i++)
+    {
+        word[i] = tolower((unsigned char)word[i]);
+    }
+    if(word[0] == '\0' || !isWord(word))
+    {
+        return "error not a word";
+    }
+
+    int check = strcmp(line, "check") == 0;
+    if(!check && strcmp(line, "suggest") != 0)
+    {
+        return "error unknown command";
+    }
+    if(check && inDictionary(server->map, server->indexes, word))
+    {
+        return "ok";
+    }
+    int found = suggest(server->map, server->indexes, server->pool, word, server->k,
+                        server->results);
+    char* suggestions = joinSuggestions(server->results, found);
+    free(server->reply);
+    if(check)
+    {
+        server->reply = malloc(strlen(suggestions) + 6);
+        strcpy(server->reply, "miss ");
+        strcat(server->reply, suggestions);
+        free(suggestions);
+    }
+    else
+    {
+        server->reply = suggestions;
+    }
+    return server->reply;
 }
 
 
 /*** MAIN *********************************************************************
  * Checks the spelling of the word provded by the user. If the word is spelled incorrectly,
- * print the 5 closest words as determined by a metric like the Levenshtein distance.
+ * print the k (default 5) closest words as determined by a metric like the Levenshtein distance.
  * Otherwise, indicate that the provded word is spelled correctly. Use dictionary.txt to
  * create the dictionary.
+ * Usage: spellChecker [-f document | -u socket] [-k count] [-c capacity]
+ *                     [-t threads] [-b] [-d] [-e distance] [-W index]
+ *                     [-i index] [-w snapshot] [-s snapshot] [-S]
+ *   -f  Check a whole document, or standard input if it is -, and write one
+ *       line per misspelling instead of asking for words.
+ *   -u  Serve check and suggest requests on a Unix domain socket until
+ *       interrupted instead of asking for words. See answerRequest.
+ *   -k  Number of suggestions to print for a misspelled word.
+ *   -c  Misspellings to remember the suggestions of, 0 to search every time.
+ *       Not used with -f, which suggests once per distinct misspelling.
+ *   -t  Threads to scan the dictionary with, 0 for one per core.
+ *   -b  Index dictionary.txt with a BK-tree and answer suggestions from it.
+ *   -d  Build a word graph of dictionary.txt and answer membership and
+ *       suggestions from it. A word ending in * is completed from the graph.
+ *   -e  Index the deletes of dictionary.txt up to distance and answer
+ *       suggestions from them, falling back when fewer than k are found.
+ *   -W  Save the index built by -e and exit.
+ *   -i  Map an index saved with -W instead of building one.
+ *   -w  Load dictionary.txt, save it as a snapshot file and exit.
+ *   -s  Map a snapshot file instead of loading dictionary.txt.
+ *   -S  Count the dictionary map's operations, searches and resizes and
+ *       print them with its shape at exit, to standard error with -f.
  * @param argc
  * @param argv
  * @return
  ****************************************************************************/
-int main(int argc, const char** argv)
+int main(int argc, char** argv)
 {
-    /*** HELPER CODE ********************************************************/
-    HashMap* map = hashMapNew(1000);
+    // Read the command line options
+    const char* writePath = NULL;
+    const char* snapshotPath = NULL;
+    const char* indexWritePath = NULL;
+    const char* indexPath = NULL;
+    const char* documentPath = NULL;
+    const char* socketPath = NULL;
+    int useTree = 0;
+    int k = 5;
+    int cacheCapacity = 1024;
+    int threads = 1;
+    int mapStats = 0;
+    Indexes indexes = {NULL, NULL, 0, NULL, 0, NULL};
+    int option;
+    while ((option = getopt(argc, argv, "f:u:k:c:t:bde:W:i:w:s:S")) != -1)
+    {
+        if (option == 'f')
+        {
+            documentPath = optarg;
+        }
+        else if (option == 'u')
+        {
+            socketPath = optarg;
+        }
+        else if (option == 'k')
+        {
+            k = atoi(optarg);
+        }
+        else if (option == 'c')
+        {
+            cacheCapacity = atoi(optarg);
+        }
+        else if (option == 't')
+        {
+            threads = atoi(optarg);
+        }
+        else if (option == 'b')
+        {
+            useTree = 1;
+        }
+        else if (option == 'd')
+        {
+            indexes.useDawg = 1;
+        }
+        else if (option == 'e')
+        {
+            indexes.symSpellDistance = atoi(optarg);
+        }
+        else if (option == 'W')
+        {
+            indexWritePath = optarg;
+        }
+        else if (option == 'i')
+        {
+            indexPath = optarg;
+        }
+        else if (option == 'w')
+        {
+            writePath = optarg;
+        }
+        else if (option == 's')
+        {
+            snapshotPath = optarg;
+        }
+        else if (option == 'S')
+        {
+            mapStats = 1;
+        }
+        else
+        {
+            printf("usage: spellChecker [-f document | -u socket] [-k count] [-c capacity] "
+                   "[-t threads] [-b] [-d] [-e distance] [-W index] [-i index] "
+                   "[-w snapshot] [-s snapshot] [-S]\n");
+            return 1;
+        }
+    }
+    if (k < 1)
+    {
+        printf("-k needs a count of at least 1\n");
+        return 1;
+    }
+    if (documentPath != NULL && socketPath != NULL)
+    {
+        printf("-f and -u cannot be combined\n");
+        return 1;
+    }
+    if (cacheCapacity < 0)
+    {
+        printf("-c needs a capacity of at least 0\n");
+        return 1;
+    }
+    if (threads == 0)
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1)
+    {
+        printf("-t needs a thread count of at least 0\n");
+        return 1;
+    }
+    // The indexes are built while dictionary.txt is read
+    if ((useTree || indexes.useDawg || indexes.symSpellDistance > 0) && snapshotPath != NULL)
+    {
+        printf("-b, -d and -e cannot be combined with -s\n");
+        return 1;
+    }
+    if (indexes.symSpellDistance < 0 || (indexWritePath != NULL && indexes.symSpellDistance == 0))
+    {
+        printf("-W needs -e with a distance of at least 1\n");
+        return 1;
+    }
 
-    // Open dictionary file and load to hash map
-    FILE* file = fopen("dictionary.txt", "r");
+    /*** HELPER CODE ********************************************************/
+    HashMap* map;
+    indexes.tree = useTree ? bkTreeNew() : NULL;
     clock_t timer = clock();
-    loadDictionary(file, map);
+    if (snapshotPath != NULL)
+    {
+        // Map the snapshot, pages are read in as lookups touch them
+        map = hashMapOpenSnapshot(snapshotPath);
+        if (map == NULL)
+        {
+            printf("Could not open snapshot %s\n", snapshotPath);
+            return 1;
+        }
+        if (mapStats)
+        {
+            hashMapEnableStats(map);
+        }
+    }
+    else
+    {
+        // Documents and server requests are mostly correct words, which the
+        // open layout finds with fewer cache misses
+        map = documentPath != NULL || socketPath != NULL ? hashMapNewLayout(1000, HASH_MAP_OPEN)
+                                                         : hashMapNew(1000);
+        hashMapSetHash(map, hashFnv1a, 0);
+        hashMapUseArena(map);
+        if (mapStats)
+        {
+            hashMapEnableStats(map);
+        }
+
+        // Open dictionary file and load to hash map
+        FILE* file = fopen("dictionary.txt", "r");
+        if (file == NULL)
+        {
+            printf("Could not open dictionary.txt\n");
+            return 1;
+        }
+        loadDictionary(file, map, &indexes);
+        fclose(file);
+    }
+    if (indexPath != NULL)
+    {
+        indexes.symSpell = symSpellOpen(indexPath);
+        if (indexes.symSpell == NULL)
+        {
+            printf("Could not open index %s\n", indexPath);
+            return 1;
+        }
+    }
     timer = clock() - timer;
-    printf("Dictionary loaded in %f seconds\n", (float)timer / (float)CLOCKS_PER_SEC);
-    fclose(file);
+    // Keep standard output for the misspellings when checking a document
+    fprintf(documentPath != NULL ? stderr : stdout, "Dictionary loaded in %f seconds\n",
+            (float)timer / (float)CLOCKS_PER_SEC);
+
+    // Save the index and stop if asked to
+    if (indexWritePath != NULL)
+    {
+        int status = symSpellSave(indexes.symSpell, indexWritePath);
+        if (status != 0)
+        {
+            printf("Could not write index %s\n", indexWritePath);
+        }
+        symSpellPrintStats(indexes.symSpell);
+        symSpellDelete(indexes.symSpell);
+        hashMapDelete(map);
+        return status != 0;
+    }
 
-    // Create input buffer and loop flag
+    // Save the snapshot and stop if asked to
+    if (writePath != NULL)
+    {
+        int status = hashMapSaveSnapshot(map, writePath);
+        if (status != 0)
+        {
+            printf("Could not write snapshot %s\n", writePath);
+        }
+        hashMapDelete(map);
+        return status != 0;
+    }
+
+    // Create input buffer, suggestion buffer and loop flag
     char inputBuffer[256];
+    Suggestion* results = malloc(sizeof(Suggestion) * k);
+    WorkerPool* pool = threads > 1 ? workerPoolNew(threads) : NULL;
+    // A document is already suggested for once per distinct misspelling
+    indexes.cache = cacheCapacity > 0 && documentPath == NULL
+                    ? suggestionCacheNew(cacheCapacity, k, map) : NULL;
     int quit = 0;
 
+    // Check a whole document instead of asking for words
+    if (documentPath != NULL)
+    {
+        FILE* document = strcmp(documentPath, "-") == 0 ? stdin : fopen(documentPath, "r");
+        if (document == NULL)
+        {
+            fprintf(stderr, "Could not open %s\n", documentPath);
+            return 1;
+        }
+        checkDocument(document, stdout, map, &indexes, pool, k, results);
+        if (document != stdin)
+        {
+            fclose(document);
+        }
+        quit = 1;
+    }
+
+    // Serve requests instead of asking for words
+    if (socketPath != NULL)
+    {
+        Server server = {map, &indexes, pool, k, results, NULL};
+        printf("Serving on %s\n", socketPath);
+        fflush(stdout);
+        if (lineServerRun(socketPath, answerRequest, &server) != 0)
+        {
+            printf("Could not listen on %s\n", socketPath);
+        }
+        free(server.reply);
+        quit = 1;
+    }
+
     /*** IMPLEMENT **********************************************************/
     while (!quit)
     {
@@ -300,15 +833,32 @@ int main(int argc, const char** argv)
         }
 
         // If the user typed quit, set quit flag to true
+        int length = strlen(inputBuffer);
         if (strcmp(inputBuffer, "quit") == 0)
         {
             quit = 1;
         }
+        // If the user typed the start of a word and a *, list words it starts
+        else if(indexes.dawg != NULL && length > 0 && inputBuffer[length - 1] == '*')
+        {
+            inputBuffer[length - 1] = '\0';
+            if(isWord(inputBuffer))
+            {
+                int printed = 0;
+                printf("Words starting with %s: ", inputBuffer);
+                dawgComplete(indexes.dawg, inputBuffer, k, printCompletion, &printed);
+                printf("%s\n", printed ? "" : "none");
+            }
+            else
+            {
+                printf("The input contained no characters or invalid characters. You may only enter letters.\n");
+            }
+        }
         // If the user input characters and it is a word...
         else if(strlen(inputBuffer) && isWord(inputBuffer))
         {
             // If the word is spelled properly (HashMap has key)...
-            if(hashMapContainsKey(map, inputBuffer))
+            if(inDictionary(map, &indexes, inputBuffer))
             {
                 // Inform user
                 printf("The inputted word... is spelled correctly\n");
@@ -318,18 +868,17 @@ int main(int argc, const char** argv)
             {
                 // Inform the user
                 printf("The inputted word... is spelled incorrectly\n");
-                
-                // Allocate memory for an array to hold 5 HashLinks
-                HashLink** alts = malloc(sizeof(HashLink*) * 5);
-                
-                //Calculate the Levenshtein Distance of all numbers and display suggestions
-                spellCheck(map, alts, inputBuffer);
+
+                // Find the closest words
+                int found = suggest(map, &indexes, pool, inputBuffer, k, results);
+
+                // Display the suggestions
                 printf("Did you mean ");
-                printf("%s, %s, %s, %s, or %s?\n", alts[0]->key, alts[1]->key, alts[2]->key, alts[3]->key, alts[4]->key);
-                
-                // Free allocated memory and set to NULL
-                free(alts);
-                alts = NULL;
+                for (int r = 0; r < found; r++)
+                {
+                    printf("%s%s", r == 0 ? "" : r == found - 1 ? ", or " : ", ", results[r].word);
+                }
+                printf("?\n");
             }
         }
         // If the string entered contains non-alpha chars, inform the user
@@ -338,8 +887,53 @@ int main(int argc, const char** argv)
             printf("The input contained no characters or invalid characters. You may only enter letters.\n");
         }
     }
-    // Delete HashMap dictionary & array of HashLinks
+    // Report how much of the dictionary the indexes searched
+    if (indexes.cache != NULL)
+    {
+        if (documentPath == NULL)
+        {
+            suggestionCachePrintStats(indexes.cache);
+        }
+        suggestionCacheDelete(indexes.cache);
+    }
+    if (indexes.symSpell != NULL)
+    {
+        if (documentPath == NULL)
+        {
+            symSpellPrintStats(indexes.symSpell);
+        }
+        symSpellDelete(indexes.symSpell);
+    }
+    if (indexes.tree != NULL)
+    {
+        if (documentPath == NULL)
+        {
+            bkTreePrintStats(indexes.tree);
+        }
+        bkTreeDelete(indexes.tree);
+    }
+    if (indexes.dawg != NULL)
+    {
+        if (documentPath == NULL)
+        {
+            dawgPrintStats(indexes.dawg);
+        }
+        dawgDelete(indexes.dawg);
+    }
+
+    // Keep a checked document's output to its misspellings
+    if (mapStats)
+    {
+        hashMapPrintStats(map, documentPath != NULL ? stderr : stdout);
+    }
+
+    // Delete HashMap dictionary & suggestion buffer
     hashMapDelete(map);
+    free(results);
+    if (pool != NULL)
+    {
+        workerPoolDelete(pool);
+    }
     
     return 0;
 }
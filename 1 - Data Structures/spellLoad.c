@@ -0,0 +1,287 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Spell Check Load Generator
+ * Description: Drives a spellChecker started with -u over several connections
+ *              at once, each keeping a number of check requests in flight,
+ *              and reports the requests per second served and the latency
+ *              percentiles of the replies.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "wordReader.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Words the requests are made from, shared by every connection.
+static const char** words;
+static int wordCount;
+
+// Settings shared by every connection.
+static const char* socketPath;
+static int requestsPerConnection = 100000;
+static int depth = 16;
+static int misspelledPercent = 10;
+
+// One connection's work and its measurements.
+typedef struct Client
+{
+    pthread_t thread;
+    int number;
+    // Seconds each request waited for its reply.
+    double* latencies;
+    int completed;
+    int failed;
+} Client;
+
+/*** IMPLEMENT ***************************************************************
+ * Returns a monotonic timestamp in seconds.
+ * @return Seconds since an arbitrary fixed point.
+ ****************************************************************************/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Compares two latencies for qsort.
+ * @param a
+ * @param b
+ * @return Negative, zero or positive as a is less than, equal to or greater
+ *         than b.
+ ****************************************************************************/
+static int compareLatencies(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Writes the next request into a buffer: a check of a dictionary word, with
+ * one letter replaced misspelledPercent of the time.
+ * @param buffer Room for the request.
+ * @param size
+ * @param seed rand_r state of the connection.
+ * @return Length of the request.
+ ****************************************************************************/
+static int makeRequest(char* buffer, size_t size, unsigned int* seed)
+{
+    const char* word = words[rand_r(seed) % wordCount];
+    int length = snprintf(buffer, size, "check %s\n", word);
+    if (rand_r(seed) % 100 < misspelledPercent)
+    {
+        buffer[6 + rand_r(seed) % strlen(word)] = 'a' + rand_r(seed) % 26;
+    }
+    return length;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Sends requestsPerConnection requests on a connection of its own, topping
+ * the requests in flight back up to depth as replies arrive, and records how
+ * long each reply took.
+ * @param arg Client.
+ * @return NULL
+ ****************************************************************************/
+static void* runClient(void* arg)
+{
+    Client* client = arg;
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        client->failed = 1;
+        return NULL;
+    }
+
+    // Send times of the requests in flight, oldest first, in a ring
+    double* sent = malloc(sizeof(double) * depth);
+    char* output = malloc((size_t)depth * 300);
+    char input[64 * 1024];
+    unsigned int seed = client->number * 7919 + 1;
+    int issued = 0;
+    while (client->completed < requestsPerConnection)
+    {
+        // Fill the window
+        size_t length = 0;
+        while (issued < requestsPerConnection && issued - client->completed < depth)
+        {
+            length += makeRequest(output + length, 300, &seed);
+            sent[issued % depth] = now();
+            issued++;
+        }
+        for (size_t written = 0; written < length;)
+        {
+            ssize_t count = write(fd, output + written, length - written);
+            if (count <= 0)
+            {
+                client->failed = 1;
+                break;
+            }
+            written += count;
+        }
+
+        // Every newline completes the oldest request in flight
+        ssize_t count = client->failed ? 0 : read(fd, input, sizeof(input));
+        if (count <= 0)
+        {
+            client->failed = 1;
+            break;
+        }
+        double received = now();
+        for (ssize_t i = 0; i < count; i++)
+        {
+            if (input[i] == '\n')
+            {
+                client->latencies[client->completed] = received - sent[client->completed % depth];
+                client->completed++;
+            }
+        }
+    }
+    free(output);
+    free(sent);
+    close(fd);
+    return NULL;
+}
+
+
+/*** MAIN *********************************************************************
+ * Usage: spellLoad [-c connections] [-d depth] [-n requests] [-m percent]
+ *                  socket [words]
+ *   -c  Connections to open at once, each served by a thread. Default 4.
+ *   -d  Requests each connection keeps in flight. Default 16.
+ *   -n  Requests sent on each connection. Default 100000.
+ *   -m  Percent of requests misspelled, which ask for suggestions. Default 10.
+ * Requests are checks of words drawn from the words file, dictionary.txt by
+ * default.
+ * @param argc
+ * @param argv
+ * @return
+ ****************************************************************************/
+int main(int argc, char** argv)
+{
+    int connections = 4;
+    int option;
+    while ((option = getopt(argc, argv, "c:d:n:m:")) != -1)
+    {
+        if (option == 'c')
+        {
+            connections = atoi(optarg);
+        }
+        else if (option == 'd')
+        {
+            depth = atoi(optarg);
+        }
+        else if (option == 'n')
+        {
+            requestsPerConnection = atoi(optarg);
+        }
+        else if (option == 'm')
+        {
+            misspelledPercent = atoi(optarg);
+        }
+        else
+        {
+            optind = argc;
+            connections = 0;
+        }
+    }
+    FILE* file = optind + 1 < argc ? fopen(argv[optind + 1], "r") : fopen("dictionary.txt", "r");
+    if (optind >= argc || connections < 1 || depth < 1 || requestsPerConnection < 1 ||
+        file == NULL)
+    {
+        printf("usage: spellLoad [-c connections] [-d depth] [-n requests] [-m percent] "
+               "socket [words]\n");
+        return 1;
+    }
+    socketPath = argv[optind];
+
+    // Read the words to check
+    WordReader* reader = wordReaderNew(file);
+    fclose(file);
+    int capacity = 1024;
+    words = malloc(sizeof(char*) * capacity);
+    const char* word;
+    int length;
+    while ((word = wordReaderNext(reader, &length)) != NULL)
+    {
+        if (length > 200)
+        {
+            continue;
+        }
+        if (wordCount == capacity)
+        {
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[wordCount++] = word;
+    }
+    if (wordCount == 0)
+    {
+        printf("no words to check\n");
+        return 1;
+    }
+
+    // Run every connection at once
+    Client* clients = calloc(connections, sizeof(Client));
+    double start = now();
+    for (int c = 0; c < connections; c++)
+    {
+        clients[c].number = c;
+        clients[c].latencies = malloc(sizeof(double) * requestsPerConnection);
+        pthread_create(&clients[c].thread, NULL, runClient, &clients[c]);
+    }
+    int total = 0;
+    int failed = 0;
+    for (int c = 0; c < connections; c++)
+    {
+        pthread_join(clients[c].thread, NULL);
+        total += clients[c].completed;
+        failed += clients[c].failed;
+    }
+    double elapsed = now() - start;
+
+    // Gather every latency to find the percentiles
+    double* latencies = malloc(sizeof(double) * (total + 1));
+    int count = 0;
+    for (int c = 0; c < connections; c++)
+    {
+        memcpy(latencies + count, clients[c].latencies, sizeof(double) * clients[c].completed);
+        count += clients[c].completed;
+        free(clients[c].latencies);
+    }
+    qsort(latencies, count, sizeof(double), compareLatencies);
+
+    if (failed > 0)
+    {
+        printf("%d of %d connections failed\n", failed, connections);
+    }
+    printf("%11s %6s %10s %12s %10s %10s %10s %10s\n", "connections", "depth", "requests",
+           "requests/s", "p50 us", "p90 us", "p99 us", "max us");
+    if (count > 0)
+    {
+        printf("%11d %6d %10d %12.0f %10.1f %10.1f %10.1f %10.1f\n", connections, depth, count,
+               count / elapsed, latencies[count / 2] * 1e6, latencies[count * 9 / 10] * 1e6,
+               latencies[count * 99 / 100] * 1e6, latencies[count - 1] * 1e6);
+    }
+
+    free(latencies);
+    free(clients);
+    free(words);
+    wordReaderDelete(reader);
+    return failed > 0;
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Suggestions
+ * Description: Bounded max-heap of the k best suggestions of a query. The
+ *              root is the worst suggestion held, so a candidate is compared
+ *              against it once and either rejected or swapped in. Ties in
+ *              distance are broken alphabetically, so the suggestions do not
+ *              depend on the order the candidates were found in.
+ *****************************************************************************/
+
+#include "suggestion.h"
+#include <string.h>
+
+/*** IMPLEMENT ***************************************************************
+ * Returns whether suggestion a ranks after b: further away, or as far and
+ * later alphabetically.
+ * @param a
+ * @param b
+ * @return Nonzero if a is worse than b.
+ */
+static int worse(const Suggestion* a, const Suggestion* b)
+{
+    return a->distance != b->distance ? a->distance > b->distance
+                                      : strcmp(a->word, b->word) > 0;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Moves the entry at i down the heap until neither child is worse.
+ * @param heap
+ * @param count Number of entries in the heap.
+ * @param i
+ */
+static void siftDown(Suggestion* heap, int count, int i)
+{
+    Suggestion moving = heap[i];
+    while (2 * i + 1 < count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < count && worse(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if (!worse(&heap[child], &moving))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = moving;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Offers a candidate to a heap of at most k suggestions. It is kept if the
+ * heap has room or it ranks before the worst suggestion held, which is then
+ * dropped.
+ * @param heap Array of at least k suggestions.
+ * @param count Number of suggestions held.
+ * @param k Maximum number of suggestions.
+ * @param word
+ * @param distance
+ * @return New number of suggestions held.
+ */
+int suggestionOffer(Suggestion* heap, int count, int k, const char* word,
+                    int distance)
+{
+    Suggestion candidate = {word, distance};
+    if (count < k)
+    {
+        // Sift the new suggestion up past better ones
+        int i = count;
+        while (i > 0 && worse(&candidate, &heap[(i - 1) / 2]))
+        {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = candidate;
+        return count + 1;
+    }
+    if (k > 0 && worse(&heap[0], &candidate))
+    {
+        heap[0] = candidate;
+        siftDown(heap, count, 0);
+    }
+    return count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the largest distance a candidate can have and still be kept.
+ * @param heap
+ * @param count Number of suggestions held.
+ * @param k Maximum number of suggestions.
+ * @param limit Largest distance of interest.
+ * @return limit, or the distance of the worst suggestion once k are held.
+ */
+int suggestionLimit(const Suggestion* heap, int count, int k, int limit)
+{
+    if (count == k && k > 0 && heap[0].distance < limit)
+    {
+        return heap[0].distance;
+    }
+    return limit;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Sorts a heap of suggestions in place, closest first.
+ * @param heap
+ * @param count Number of suggestions held.
+ */
+void suggestionSort(Suggestion* heap, int count)
+{
+    // Repeatedly move the worst suggestion to the end
+    for (int end = count - 1; end > 0; end--)
+    {
+        Suggestion worst = heap[0];
+        heap[0] = heap[end];
+        heap[end] = worst;
+        siftDown(heap, end, 0);
+    }
+}
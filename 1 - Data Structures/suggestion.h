@@ -0,0 +1,28 @@
+#ifndef SUGGESTION_H
+#define SUGGESTION_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Suggestions
+ * Description: Header file for the word and distance pairs returned by the
+ *              spelling suggestion searches. A search keeps its k best
+ *              candidates in a bounded max-heap held in the caller's results
+ *              array, then sorts them closest first.
+ *****************************************************************************/
+
+typedef struct Suggestion Suggestion;
+
+struct Suggestion
+{
+    // Dictionary word, owned by whatever was searched.
+    const char* word;
+    // Edit distance from the query.
+    int distance;
+};
+
+int suggestionOffer(Suggestion* heap, int count, int k, const char* word,
+                    int distance);
+int suggestionLimit(const Suggestion* heap, int count, int k, int limit);
+void suggestionSort(Suggestion* heap, int count);
+
+#endif
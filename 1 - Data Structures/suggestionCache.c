@@ -0,0 +1,233 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Suggestion Cache
+ * Description: Least recently used cache of suggestions. A hit costs one Hash
+ *              Map lookup and copying k suggestions, instead of a search of
+ *              the dictionary.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "suggestionCache.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/*** IMPLEMENT ***************************************************************
+ * Creates an empty cache.
+ * @param capacity Number of words to remember, at least 1.
+ * @param k Most suggestions stored per word.
+ * @param dictionary Map the suggestions are found from. The cache empties
+ *                   itself whenever the map's version changes.
+ * @return The allocated cache.
+ */
+SuggestionCache* suggestionCacheNew(int capacity, int k, HashMap* dictionary)
+{
+    assert(capacity > 0 && k > 0 && dictionary != NULL);
+    SuggestionCache* cache = malloc(sizeof(SuggestionCache));
+    cache->index = hashMapNewLayout(capacity, HASH_MAP_OPEN);
+    cache->entries = malloc(sizeof(CacheEntry) * capacity);
+    cache->suggestions = malloc(sizeof(Suggestion) * (size_t)capacity * k);
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->k = k;
+    cache->newest = -1;
+    cache->oldest = -1;
+    cache->dictionary = dictionary;
+    cache->version = dictionary->version;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->invalidations = 0;
+    return cache;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the cache and its copies of the words.
+ * @param cache
+ */
+void suggestionCacheDelete(SuggestionCache* cache)
+{
+    assert(cache != NULL);
+    for(int i = 0; i < cache->count; i++)
+    {
+        free(cache->entries[i].word);
+    }
+    hashMapDelete(cache->index);
+    free(cache->entries);
+    free(cache->suggestions);
+    free(cache);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Takes an entry off the use list.
+ * @param cache
+ * @param e Entry number.
+ */
+static void unlinkEntry(SuggestionCache* cache, int e)
+{
+    CacheEntry* entry = &cache->entries[e];
+    if(entry->newer != -1)
+    {
+        cache->entries[entry->newer].older = entry->older;
+    }
+    else
+    {
+        cache->newest = entry->older;
+    }
+    if(entry->older != -1)
+    {
+        cache->entries[entry->older].newer = entry->newer;
+    }
+    else
+    {
+        cache->oldest = entry->newer;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Puts an entry at the most recently used end of the use list.
+ * @param cache
+ * @param e Entry number, not on the list.
+ */
+static void pushNewest(SuggestionCache* cache, int e)
+{
+    CacheEntry* entry = &cache->entries[e];
+    entry->newer = -1;
+    entry->older = cache->newest;
+    if(cache->newest != -1)
+    {
+        cache->entries[cache->newest].newer = e;
+    }
+    else
+    {
+        cache->oldest = e;
+    }
+    cache->newest = e;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Empties the cache if the dictionary changed since it was filled.
+ * @param cache
+ */
+static void checkVersion(SuggestionCache* cache)
+{
+    if(cache->dictionary->version != cache->version)
+    {
+        suggestionCacheClear(cache);
+        cache->version = cache->dictionary->version;
+        cache->invalidations++;
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Forgets every word in the cache. The counters are kept.
+ * @param cache
+ */
+void suggestionCacheClear(SuggestionCache* cache)
+{
+    assert(cache != NULL);
+    for(int i = 0; i < cache->count; i++)
+    {
+        hashMapRemove(cache->index, cache->entries[i].word);
+        free(cache->entries[i].word);
+    }
+    cache->count = 0;
+    cache->newest = -1;
+    cache->oldest = -1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Looks up the suggestions stored for a word and marks it recently used.
+ * @param cache
+ * @param word Word as it was passed to suggestionCachePut.
+ * @param results Array of at least k suggestions, filled closest first.
+ * @return Number of suggestions copied to results, or -1 if the word is not
+ *         cached.
+ */
+int suggestionCacheGet(SuggestionCache* cache, const char* word, Suggestion* results)
+{
+    assert(cache != NULL && word != NULL && results != NULL);
+    checkVersion(cache);
+    int* e = hashMapGet(cache->index, word);
+    if(e == NULL)
+    {
+        cache->misses++;
+        return -1;
+    }
+    cache->hits++;
+    CacheEntry* entry = &cache->entries[*e];
+    memcpy(results, &cache->suggestions[(size_t)*e * cache->k], sizeof(Suggestion) * entry->found);
+    if(cache->newest != *e)
+    {
+        unlinkEntry(cache, *e);
+        pushNewest(cache, *e);
+    }
+    return entry->found;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Stores the suggestions found for a word, replacing the least recently used
+ * word when the cache is full.
+ * @param cache
+ * @param word
+ * @param results Suggestions closest first.
+ * @param found Number of suggestions in results, at most k.
+ */
+void suggestionCachePut(SuggestionCache* cache, const char* word,
+                        const Suggestion* results, int found)
+{
+    assert(cache != NULL && word != NULL && found >= 0 && found <= cache->k);
+    checkVersion(cache);
+
+    // Reuse the word's entry, a free one, or the oldest
+    int* existing = hashMapGet(cache->index, word);
+    int e;
+    if(existing != NULL)
+    {
+        e = *existing;
+        unlinkEntry(cache, e);
+    }
+    else
+    {
+        if(cache->count < cache->capacity)
+        {
+            e = cache->count++;
+        }
+        else
+        {
+            e = cache->oldest;
+            unlinkEntry(cache, e);
+            hashMapRemove(cache->index, cache->entries[e].word);
+            free(cache->entries[e].word);
+        }
+        cache->entries[e].word = strdup(word);
+        hashMapPut(cache->index, word, e);
+    }
+
+    cache->entries[e].found = found;
+    memcpy(&cache->suggestions[(size_t)e * cache->k], results, sizeof(Suggestion) * found);
+    pushNewest(cache, e);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints how often lookups hit the cache.
+ * @param cache
+ */
+void suggestionCachePrintStats(SuggestionCache* cache)
+{
+    assert(cache != NULL);
+    long long lookups = cache->hits + cache->misses;
+    printf("Suggestion cache: %lld lookups, %lld hits (%.1f%%), %d of %d words held, "
+           "%lld invalidations\n", lookups, cache->hits,
+           lookups ? 100.0 * cache->hits / lookups : 0.0, cache->count, cache->capacity,
+           cache->invalidations);
+}
@@ -0,0 +1,60 @@
+#ifndef SUGGESTION_CACHE_H
+#define SUGGESTION_CACHE_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Suggestion Cache
+ * Description: Header file for a least recently used cache of the suggestions
+ *              found for misspelled words. Entries are found through a Hash
+ *              Map and kept on a list ordered by use, and the whole cache is
+ *              dropped when the dictionary it was filled from changes.
+ *****************************************************************************/
+
+#include "hashMap.h"
+#include "suggestion.h"
+
+typedef struct CacheEntry CacheEntry;
+typedef struct SuggestionCache SuggestionCache;
+
+struct CacheEntry
+{
+    // Misspelled word, or NULL if the entry is unused.
+    char* word;
+    // Number of suggestions stored for word.
+    int found;
+    // Neighbours on the use list, or -1 at either end.
+    int newer;
+    int older;
+};
+
+struct SuggestionCache
+{
+    // Word to entry number.
+    HashMap* index;
+    CacheEntry* entries;
+    // k suggestions for each entry. The words point into whatever was
+    // searched, so the cache must not outlive the dictionary or its indexes.
+    Suggestion* suggestions;
+    int capacity;
+    int count;
+    int k;
+    // Most and least recently used entries, or -1 if the cache is empty.
+    int newest;
+    int oldest;
+    // Dictionary the suggestions came from and its version when they did.
+    HashMap* dictionary;
+    unsigned long version;
+    long long hits;
+    long long misses;
+    long long invalidations;
+};
+
+SuggestionCache* suggestionCacheNew(int capacity, int k, HashMap* dictionary);
+void suggestionCacheDelete(SuggestionCache* cache);
+int suggestionCacheGet(SuggestionCache* cache, const char* word, Suggestion* results);
+void suggestionCachePut(SuggestionCache* cache, const char* word,
+                        const Suggestion* results, int found);
+void suggestionCacheClear(SuggestionCache* cache);
+void suggestionCachePrintStats(SuggestionCache* cache);
+
+#endif
@@ -0,0 +1,579 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Symmetric Delete Index
+ * Description: Two words are within edit distance d exactly when deleting at
+ *              most d letters from each reaches a common string. The index
+ *              stores the deletes of every dictionary word, and a query
+ *              generates its own deletes, looks each one up and verifies the
+ *              words found with the bit-parallel Levenshtein kernel.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "symSpell.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SYM_SPELL_MAGIC "SYMSPL1"
+
+// Header of a saved index. The word offsets, posting offsets, postings and
+// word bytes follow in that order.
+typedef struct SymSpellHeader
+{
+    char magic[8];
+    int32_t maxDistance;
+    int32_t prefixLength;
+    int32_t wordCount;
+    int32_t deleteCount;
+    uint64_t postingCount;
+    uint64_t wordBytes;
+} SymSpellHeader;
+
+// Growable list of null terminated deletes packed back to back.
+typedef struct DeleteList
+{
+    char* bytes;
+    size_t used;
+    size_t capacity;
+    int count;
+} DeleteList;
+
+/*** IMPLEMENT ***************************************************************
+ * Appends a string to a delete list.
+ * @param list
+ * @param text
+ * @param length Letters of text to append.
+ */
+static void deleteListAdd(DeleteList* list, const char* text, int length)
+{
+    if (list->used + length + 1 > list->capacity)
+    {
+        list->capacity = 2 * (list->used + length + 1);
+        list->bytes = realloc(list->bytes, list->capacity);
+    }
+    memcpy(list->bytes + list->used, text, length);
+    list->bytes[list->used + length] = '\0';
+    list->used += length + 1;
+    list->count++;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Adds text and every string made by deleting up to remaining of its letters
+ * at or after start. Letters are only deleted left to right, so each set of
+ * deleted positions is generated once.
+ * @param list
+ * @param text
+ * @param length
+ * @param start First position that may be deleted.
+ * @param remaining Letters that may still be deleted.
+ */
+static void addDeletes(DeleteList* list, const char* text, int length, int start,
+                       int remaining)
+{
+    deleteListAdd(list, text, length);
+    if (remaining == 0 || length == 0)
+    {
+        return;
+    }
+    char shorter[length];
+    for (int i = start; i < length; i++)
+    {
+        memcpy(shorter, text, i);
+        memcpy(shorter + i, text + i + 1, length - i - 1);
+        addDeletes(list, shorter, length - 1, i, remaining - 1);
+    }
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Fills a delete list with the deletes of the indexed prefix of a word.
+ * @param index
+ * @param list Emptied first.
+ * @param word
+ */
+static void wordDeletes(SymSpell* index, DeleteList* list, const char* word)
+{
+    int length = strlen(word);
+    if (length > index->prefixLength)
+    {
+        length = index->prefixLength;
+    }
+    list->used = 0;
+    list->count = 0;
+    addDeletes(list, word, length, 0, index->maxDistance);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds the index of a dictionary. The words are copied.
+ * @param words
+ * @param count Number of words.
+ * @param maxDistance Largest edit distance queries can find.
+ * @param prefixLength Letters of each word deletes are generated from.
+ * @return The allocated index.
+ */
+SymSpell* symSpellNew(const char** words, int count, int maxDistance,
+                      int prefixLength)
+{
+    assert(words != NULL || count == 0);
+    assert(maxDistance >= 0 && prefixLength > maxDistance);
+    SymSpell* index = calloc(1, sizeof(SymSpell));
+    index->maxDistance = maxDistance;
+    index->prefixLength = prefixLength;
+
+    // Copy the words into one block
+    index->wordCount = count;
+    index->wordOffsets = malloc(sizeof(uint32_t) * (count + 1));
+    for (int w = 0; w < count; w++)
+    {
+        index->wordOffsets[w] = index->wordBytes;
+        index->wordBytes += strlen(words[w]) + 1;
+    }
+    index->words = malloc(index->wordBytes + 1);
+    for (int w = 0; w < count; w++)
+    {
+        strcpy(index->words + index->wordOffsets[w], words[w]);
+    }
+
+    // Number every delete and record a (delete, word) pair for each
+    index->deletes = hashMapNewLayout(count * 4, HASH_MAP_OPEN);
+    hashMapSetHash(index->deletes, hashFnv1a, 0);
+    hashMapUseArena(index->deletes);
+    long pairCapacity = (long)count * 8 + 1;
+    long pairCount = 0;
+    uint32_t* pairDelete = malloc(sizeof(uint32_t) * pairCapacity);
+    uint32_t* pairWord = malloc(sizeof(uint32_t) * pairCapacity);
+    DeleteList list = {NULL, 0, 0, 0};
+    for (int w = 0; w < count; w++)
+    {
+        wordDeletes(index, &list, words[w]);
+        const char* text = list.bytes;
+        for (int i = 0; i < list.count; i++)
+        {
+            int* number = hashMapGet(index->deletes, text);
+            int d;
+            if (number == NULL)
+            {
+                d = index->deleteCount++;
+                hashMapPut(index->deletes, text, d);
+            }
+            else
+            {
+                d = *number;
+            }
+            if (pairCount == pairCapacity)
+            {
+                pairCapacity *= 2;
+                pairDelete = realloc(pairDelete, sizeof(uint32_t) * pairCapacity);
+                pairWord = realloc(pairWord, sizeof(uint32_t) * pairCapacity);
+            }
+            pairDelete[pairCount] = d;
+            pairWord[pairCount++] = w;
+            text += strlen(text) + 1;
+        }
+    }
+    free(list.bytes);
+
+    // Group the pairs by delete. Words arrive in order, so a word that
+    // reaches a delete more than once has its repeats side by side.
+    uint32_t* offsets = calloc(index->deleteCount + 1, sizeof(uint32_t));
+    for (long p = 0; p < pairCount; p++)
+    {
+        offsets[pairDelete[p] + 1]++;
+    }
+    for (int d = 0; d < index->deleteCount; d++)
+    {
+        offsets[d + 1] += offsets[d];
+    }
+    uint32_t* grouped = malloc(sizeof(uint32_t) * (pairCount + 1));
+    uint32_t* next = malloc(sizeof(uint32_t) * (index->deleteCount + 1));
+    memcpy(next, offsets, sizeof(uint32_t) * (index->deleteCount + 1));
+    for (long p = 0; p < pairCount; p++)
+    {
+        grouped[next[pairDelete[p]]++] = pairWord[p];
+    }
+    free(next);
+    free(pairDelete);
+    free(pairWord);
+
+    // Drop the repeats while copying the postings into place
+    index->postingOffsets = malloc(sizeof(uint32_t) * (index->deleteCount + 1));
+    index->postings = grouped;
+    long kept = 0;
+    for (int d = 0; d < index->deleteCount; d++)
+    {
+        index->postingOffsets[d] = kept;
+        for (uint32_t p = offsets[d]; p < offsets[d + 1]; p++)
+        {
+            if (p == offsets[d] || grouped[p] != grouped[p - 1])
+            {
+                grouped[kept++] = grouped[p];
+            }
+        }
+    }
+    index->postingOffsets[index->deleteCount] = kept;
+    index->postingCount = kept;
+    index->postings = realloc(grouped, sizeof(uint32_t) * (kept + 1));
+    free(offsets);
+
+    index->seen = calloc(count + 1, sizeof(uint32_t));
+    return index;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the index and everything it holds or has mapped.
+ * @param index
+ */
+void symSpellDelete(SymSpell* index)
+{
+    assert(index != NULL);
+    hashMapDelete(index->deletes);
+    if (index->image != NULL)
+    {
+        munmap(index->image, index->imageSize);
+    }
+    else
+    {
+        free(index->postingOffsets);
+        free(index->postings);
+        free(index->wordOffsets);
+        free(index->words);
+    }
+    free(index->seen);
+    free(index);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Finds the k words closest to a word within the index's maximum distance,
+ * ties broken alphabetically.
+ * @param index
+ * @param word Query.
+ * @param k Maximum number of results.
+ * @param results Array of at least k results, filled closest first.
+ * @return Number of results found, fewer than k if fewer words are within
+ *         maxDistance.
+ */
+int symSpellQuery(SymSpell* index, const char* word, int k, Suggestion* results)
+{
+    assert(index != NULL && word != NULL && results != NULL);
+    index->queries++;
+    if (k <= 0)
+    {
+        return 0;
+    }
+
+    // Start a new round of seen marks, clearing them when the stamp wraps
+    if (++index->stamp == 0)
+    {
+        memset(index->seen, 0, sizeof(uint32_t) * index->wordCount);
+        index->stamp = 1;
+    }
+
+    LevenshteinPattern* pattern = levenshteinPatternNew(word);
+    DeleteList list = {NULL, 0, 0, 0};
+    wordDeletes(index, &list, word);
+    int count = 0;
+    int radius = index->maxDistance;
+
+    // Verify each word sharing a delete with the query
+    const char* text = list.bytes;
+    for (int i = 0; i < list.count; i++, text += strlen(text) + 1)
+    {
+        int* number = hashMapGet(index->deletes, text);
+        if (number == NULL)
+        {
+            continue;
+        }
+        for (uint32_t p = index->postingOffsets[*number];
+             p < index->postingOffsets[*number + 1]; p++)
+        {
+            uint32_t w = index->postings[p];
+            if (index->seen[w] == index->stamp)
+            {
+                continue;
+            }
+            index->seen[w] = index->stamp;
+            index->candidates++;
+
+            const char* candidate = index->words + index->wordOffsets[w];
+            int distance = levenshteinDistanceBounded(pattern, candidate, radius);
+            if (distance <= radius)
+            {
+                count = suggestionOffer(results, count, k, candidate, distance);
+                radius = suggestionLimit(results, count, k, radius);
+            }
+        }
+    }
+    free(list.bytes);
+    levenshteinPatternDelete(pattern);
+    suggestionSort(results, count);
+    return count;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Builds the path of the snapshot holding a saved index's delete map.
+ * @param path Path of the saved index.
+ * @return Allocated path.
+ */
+static char* deletesPath(const char* path)
+{
+    char* result = malloc(strlen(path) + sizeof(".deletes"));
+    strcpy(result, path);
+    strcat(result, ".deletes");
+    return result;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Saves the index so symSpellOpen can map it instead of rebuilding it. The
+ * postings and words go to path and the delete map to path.deletes.
+ * @param index
+ * @param path
+ * @return 0 on success, -1 if a file could not be written.
+ */
+int symSpellSave(SymSpell* index, const char* path)
+{
+    assert(index != NULL && path != NULL);
+    SymSpellHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SYM_SPELL_MAGIC, sizeof(header.magic));
+    header.maxDistance = index->maxDistance;
+    header.prefixLength = index->prefixLength;
+    header.wordCount = index->wordCount;
+    header.deleteCount = index->deleteCount;
+    header.postingCount = index->postingCount;
+    header.wordBytes = index->wordBytes;
+
+    int status = -1;
+    FILE* file = fopen(path, "wb");
+    if (file != NULL)
+    {
+        if (fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(index->wordOffsets, sizeof(uint32_t), index->wordCount, file) ==
+                (size_t)index->wordCount &&
+            fwrite(index->postingOffsets, sizeof(uint32_t), index->deleteCount + 1, file) ==
+                (size_t)index->deleteCount + 1 &&
+            fwrite(index->postings, sizeof(uint32_t), index->postingCount, file) ==
+                (size_t)index->postingCount &&
+            fwrite(index->words, 1, index->wordBytes, file) == index->wordBytes)
+        {
+            status = 0;
+        }
+        if (fclose(file) != 0)
+        {
+            status = -1;
+        }
+    }
+
+    char* mapPath = deletesPath(path);
+    if (status == 0)
+    {
+        status = hashMapSaveSnapshot(index->deletes, mapPath);
+    }
+    free(mapPath);
+    return status;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Checks that a mapped index's counts fit the file and that every offset and
+ * word number in it points inside the sections it indexes, so queries on a
+ * truncated or corrupt index cannot read outside the mapping.
+ * @param image
+ * @param size Bytes mapped.
+ * @return 1 if the index can be used, 0 if not.
+ */
+static int indexValid(const void* image, size_t size)
+{
+    const SymSpellHeader* header = image;
+    if (memcmp(header->magic, SYM_SPELL_MAGIC, sizeof(header->magic)) != 0 ||
+        header->maxDistance < 0 || header->prefixLength <= header->maxDistance ||
+        header->wordCount < 0 || header->deleteCount < 0 ||
+        header->postingCount > size / sizeof(uint32_t) || header->wordBytes > size)
+    {
+        return 0;
+    }
+    size_t expected = sizeof(SymSpellHeader) +
+        sizeof(uint32_t) * ((size_t)header->wordCount + header->deleteCount + 1 +
+                            header->postingCount) + header->wordBytes;
+    if (expected != size)
+    {
+        return 0;
+    }
+
+    const uint32_t* wordOffsets = (const uint32_t*)(header + 1);
+    const uint32_t* postingOffsets = wordOffsets + header->wordCount;
+    const uint32_t* postings = postingOffsets + header->deleteCount + 1;
+    const char* words = (const char*)(postings + header->postingCount);
+
+    // Every word must start, and end with its terminator, inside the words
+    if (header->wordCount > 0 &&
+        (header->wordBytes == 0 || words[header->wordBytes - 1] != '\0'))
+    {
+        return 0;
+    }
+    for (int32_t w = 0; w < header->wordCount; w++)
+    {
+        if (wordOffsets[w] >= header->wordBytes)
+        {
+            return 0;
+        }
+    }
+
+    // Every delete must own an ordered slice of postings naming real words
+    if (postingOffsets[0] != 0 || postingOffsets[header->deleteCount] != header->postingCount)
+    {
+        return 0;
+    }
+    for (int32_t d = 0; d < header->deleteCount; d++)
+    {
+        if (postingOffsets[d] > postingOffsets[d + 1])
+        {
+            return 0;
+        }
+    }
+    for (uint64_t p = 0; p < header->postingCount; p++)
+    {
+        if (postings[p] >= (uint32_t)header->wordCount)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Checks that every delete in a mapped delete map numbers one of count
+ * deletes.
+ * @param deletes
+ * @param count
+ * @return 1 if every number is in range, 0 if not.
+ */
+static int deletesValid(HashMap* deletes, int count)
+{
+    HashMapIterator iterator;
+    hashMapIteratorInit(deletes, &iterator);
+    int number;
+    while (hashMapIteratorNext(&iterator, NULL, &number))
+    {
+        if (number < 0 || number >= count)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Maps an index saved by symSpellSave. Nothing is rebuilt; pages are read in
+ * as queries touch them.
+ * @param path
+ * @return The index, or NULL if either file is missing, not an index, or
+ *         truncated or corrupt.
+ */
+SymSpell* symSpellOpen(const char* path)
+{
+    assert(path != NULL);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SymSpellHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    void* image = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // Check the header describes this file
+    const SymSpellHeader* header = image;
+    char* mapPath = deletesPath(path);
+    HashMap* deletes = NULL;
+    if (indexValid(image, info.st_size))
+    {
+        deletes = hashMapOpenSnapshot(mapPath);
+    }
+    free(mapPath);
+    if (deletes != NULL && !deletesValid(deletes, header->deleteCount))
+    {
+        hashMapDelete(deletes);
+        deletes = NULL;
+    }
+    if (deletes == NULL)
+    {
+        munmap(image, info.st_size);
+        return NULL;
+    }
+
+    SymSpell* index = calloc(1, sizeof(SymSpell));
+    index->maxDistance = header->maxDistance;
+    index->prefixLength = header->prefixLength;
+    index->deletes = deletes;
+    index->deleteCount = header->deleteCount;
+    index->postingCount = header->postingCount;
+    index->wordCount = header->wordCount;
+    index->wordBytes = header->wordBytes;
+    index->wordOffsets = (uint32_t*)(header + 1);
+    index->postingOffsets = index->wordOffsets + index->wordCount;
+    index->postings = index->postingOffsets + index->deleteCount + 1;
+    index->words = (char*)(index->postings + index->postingCount);
+    index->image = image;
+    index->imageSize = info.st_size;
+    index->seen = calloc(index->wordCount + 1, sizeof(uint32_t));
+    return index;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the bytes of memory the index holds, including its delete map.
+ * @param index
+ * @return Bytes held by the index.
+ */
+size_t symSpellBytes(SymSpell* index)
+{
+    assert(index != NULL);
+    size_t bytes = sizeof(SymSpell) + hashMapBytes(index->deletes) +
+                   sizeof(uint32_t) * (index->wordCount + 1);
+    if (index->image != NULL)
+    {
+        return bytes + index->imageSize;
+    }
+    return bytes + sizeof(uint32_t) * (index->wordCount + 1 + index->deleteCount + 1 +
+                                       index->postingCount) + index->wordBytes;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Prints the size of the index and how many words each query verified.
+ * @param index
+ */
+void symSpellPrintStats(SymSpell* index)
+{
+    assert(index != NULL);
+    double average = index->queries ? (double)index->candidates / index->queries : 0;
+    printf("SymSpell: distance %d, prefix %d, %d words, %d deletes, %ld postings, "
+           "%.1f MB\n", index->maxDistance, index->prefixLength, index->wordCount,
+           index->deleteCount, index->postingCount, symSpellBytes(index) / 1e6);
+    printf("SymSpell: %ld queries, %.0f words verified per query\n",
+           index->queries, average);
+}
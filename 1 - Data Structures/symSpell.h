@@ -0,0 +1,62 @@
+#ifndef SYM_SPELL_H
+#define SYM_SPELL_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Symmetric Delete Index
+ * Description: Header file for a SymSpell style suggestion index. Every
+ *              string reachable from a dictionary word by deleting up to
+ *              maxDistance letters maps to the words it came from, so the
+ *              words near a query are found by probing the query's own
+ *              deletes instead of comparing against the whole dictionary.
+ *****************************************************************************/
+
+#include "hashMap.h"
+#include "suggestion.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Letters of each word that deletes are generated from. Longer words are
+// indexed by their prefix, which bounds the deletes generated per word.
+#define SYM_SPELL_PREFIX 7
+
+typedef struct SymSpell SymSpell;
+
+struct SymSpell
+{
+    int maxDistance;
+    int prefixLength;
+    // Maps each delete to its number.
+    HashMap* deletes;
+    int deleteCount;
+    // Words of delete d are postings[postingOffsets[d]] up to
+    // postings[postingOffsets[d + 1]], numbered as in wordOffsets.
+    uint32_t* postingOffsets;
+    uint32_t* postings;
+    long postingCount;
+    // Word w starts at words + wordOffsets[w].
+    int wordCount;
+    uint32_t* wordOffsets;
+    char* words;
+    size_t wordBytes;
+    // Saved index mapped by symSpellOpen, or NULL if built in memory.
+    void* image;
+    size_t imageSize;
+    // Query number each word was last checked by, so it is checked once.
+    uint32_t* seen;
+    uint32_t stamp;
+    // Totals over every symSpellQuery.
+    long queries;
+    long candidates;
+};
+
+SymSpell* symSpellNew(const char** words, int count, int maxDistance,
+                      int prefixLength);
+void symSpellDelete(SymSpell* index);
+int symSpellQuery(SymSpell* index, const char* word, int k, Suggestion* results);
+int symSpellSave(SymSpell* index, const char* path);
+SymSpell* symSpellOpen(const char* path);
+size_t symSpellBytes(SymSpell* index);
+void symSpellPrintStats(SymSpell* index);
+
+#endif
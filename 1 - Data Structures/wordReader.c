@@ -0,0 +1,198 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Word Reader
+ * Description: Splits a file into words made of letters, digits and
+ *              apostrophes. The file is read in WORD_READER_BLOCK sized
+ *              blocks, word boundaries are found with a lookup table, and the
+ *              byte after each word is overwritten with a null terminator.
+ *              A streaming reader slides the unscanned bytes to the front of
+ *              its buffer before each read, so only the word being scanned
+ *              has to fit.
+ *****************************************************************************/
+
+#include "wordReader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// Nonzero for bytes that belong to a word. Filled on first use.
+static unsigned char wordBytes[256];
+static int wordBytesReady = 0;
+
+/*** IMPLEMENT ***************************************************************
+ * Fills the table of bytes that belong to a word.
+ */
+static void wordBytesInit()
+{
+    for (int c = 0; c < 256; c++)
+    {
+        wordBytes[c] = (c >= '0' && c <= '9') ||
+                       (c >= 'A' && c <= 'Z') ||
+                       (c >= 'a' && c <= 'z') ||
+                       c == '\'';
+    }
+    wordBytesReady = 1;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates a reader with an empty buffer.
+ * @param file
+ * @return The allocated reader.
+ */
+static WordReader* wordReaderAlloc(FILE* file)
+{
+    assert(file != NULL);
+    if (!wordBytesReady)
+    {
+        wordBytesInit();
+    }
+    WordReader* reader = malloc(sizeof(WordReader));
+    reader->capacity = WORD_READER_BLOCK;
+    reader->buffer = malloc(reader->capacity + 1);
+    reader->buffer[0] = '\0';
+    reader->size = 0;
+    reader->position = 0;
+    reader->file = file;
+    reader->discarded = 0;
+    reader->offset = 0;
+    return reader;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Discards the bytes before keep and reads the next block of a streamed file
+ * after the rest, growing the buffer if keep is at its start.
+ * @param reader
+ * @param keep First buffer byte still needed.
+ * @return Number of bytes read, 0 at the end of the file.
+ */
+static size_t wordReaderFill(WordReader* reader, size_t keep)
+{
+    if (reader->file == NULL)
+    {
+        return 0;
+    }
+    memmove(reader->buffer, reader->buffer + keep, reader->size - keep);
+    reader->size -= keep;
+    reader->position -= keep;
+    reader->discarded += keep;
+    if (reader->size == reader->capacity)
+    {
+        reader->capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->capacity + 1);
+    }
+    size_t got = fread(reader->buffer + reader->size, 1, reader->capacity - reader->size,
+                       reader->file);
+    reader->size += got;
+    reader->buffer[reader->size] = '\0';
+    if (got == 0)
+    {
+        reader->file = NULL;
+    }
+    return got;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Reads the rest of a file into a new reader. Every word it returns stays
+ * valid until the reader is deleted.
+ * @param file Open file, read to the end but not closed.
+ * @return The allocated reader.
+ */
+WordReader* wordReaderNew(FILE* file)
+{
+    WordReader* reader = wordReaderAlloc(file);
+    // Read block after block, doubling the buffer as it fills
+    while (wordReaderFill(reader, 0) > 0)
+    {
+    }
+    return reader;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates a reader that reads a file a block at a time as words are asked
+ * for. Each word it returns is only valid until the next call to
+ * wordReaderNext.
+ * @param file Open file, read as needed but not closed.
+ * @return The allocated reader.
+ */
+WordReader* wordReaderStream(FILE* file)
+{
+    return wordReaderAlloc(file);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Frees the reader and its buffer. Every word it returned becomes invalid.
+ * @param reader
+ */
+void wordReaderDelete(WordReader* reader)
+{
+    assert(reader != NULL);
+    free(reader->buffer);
+    free(reader);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Returns the next word of the file and records its position in the file in
+ * reader->offset. The word points into the reader's buffer.
+ * @param reader
+ * @param length If not NULL, set to the length of the word.
+ * @return Null terminated word, or NULL after the last word.
+ */
+char* wordReaderNext(WordReader* reader, int* length)
+{
+    assert(reader != NULL);
+    size_t i = reader->position;
+
+    // Skip to the start of the next word, reading more when the buffer runs out
+    while (1)
+    {
+        while (i < reader->size && !wordBytes[(unsigned char)reader->buffer[i]])
+        {
+            i++;
+        }
+        if (i < reader->size)
+        {
+            break;
+        }
+        reader->position = i;
+        if (wordReaderFill(reader, i) == 0)
+        {
+            return NULL;
+        }
+        i = reader->position;
+    }
+
+    // Find the end of the word. A word that reaches the end of the buffer
+    // may continue in the next block.
+    size_t start = i;
+    while (1)
+    {
+        // The terminator after the last byte read stops the scan
+        while (wordBytes[(unsigned char)reader->buffer[i]])
+        {
+            i++;
+        }
+        if (i < reader->size || reader->file == NULL)
+        {
+            break;
+        }
+        reader->position = i;
+        size_t scanned = i - start;
+        wordReaderFill(reader, start);
+        start = 0;
+        i = scanned;
+    }
+    reader->buffer[i] = '\0';
+    reader->position = i < reader->size ? i + 1 : reader->size;
+    reader->offset = reader->discarded + start;
+    if (length != NULL)
+    {
+        *length = (int)(i - start);
+    }
+    return reader->buffer + start;
+}
@@ -0,0 +1,42 @@
+#ifndef WORD_READER_H
+#define WORD_READER_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Word Reader
+ * Description: Header file for a tokenizer that reads a file in large blocks
+ *              and splits it into words in place. Each word is handed out as
+ *              a null terminated slice of the reader's buffer, so no word is
+ *              allocated or copied. A reader either holds the whole file, so
+ *              every word stays valid, or streams it through a fixed buffer
+ *              for files too large to hold.
+ *****************************************************************************/
+
+#include <stdio.h>
+
+// Bytes requested from the file per read.
+#define WORD_READER_BLOCK (256 * 1024)
+
+typedef struct WordReader WordReader;
+
+struct WordReader
+{
+    // Bytes read and not yet discarded, plus a null terminator.
+    char* buffer;
+    size_t size;
+    size_t capacity;
+    // Offset of the first byte not yet scanned.
+    size_t position;
+    // File still being streamed, or NULL once the whole file is in buffer.
+    FILE* file;
+    // Offset in the file of buffer[0], and of the last word returned.
+    long long discarded;
+    long long offset;
+};
+
+WordReader* wordReaderNew(FILE* file);
+WordReader* wordReaderStream(FILE* file);
+void wordReaderDelete(WordReader* reader);
+char* wordReaderNext(WordReader* reader, int* length);
+
+#endif
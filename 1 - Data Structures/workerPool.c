@@ -0,0 +1,154 @@
+/******************************************************************************
+ * CS 261 Data Structures
+ * Worker Pool
+ * Description: Threads wait on a condition variable for the job generation
+ *              to change, run their share of the job, and the last one to
+ *              finish wakes the caller.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "workerPool.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <signal.h>
+
+// Worker number passed to each pool thread.
+typedef struct WorkerStart
+{
+    WorkerPool* pool;
+    int worker;
+} WorkerStart;
+
+/*** IMPLEMENT ***************************************************************
+ * Body of each pool thread: runs every job until the pool is deleted.
+ * @param arg WorkerStart, freed by the thread.
+ * @return NULL
+ */
+static void* workerMain(void* arg)
+{
+    WorkerStart* start = arg;
+    WorkerPool* pool = start->pool;
+    int worker = start->worker;
+    free(start);
+
+    long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1)
+    {
+        // Wait for a job this thread has not run yet
+        while (!pool->stopping && pool->generation == seen)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping)
+        {
+            break;
+        }
+        seen = pool->generation;
+        WorkerTask task = pool->task;
+        void* taskArg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(taskArg, worker, pool->workers);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Creates a pool and starts workers - 1 threads.
+ * @param workers Number of workers including the caller, at least 1.
+ * @return The allocated pool.
+ */
+WorkerPool* workerPoolNew(int workers)
+{
+    assert(workers >= 1);
+    WorkerPool* pool = malloc(sizeof(WorkerPool));
+    pool->workers = workers;
+    pool->threads = malloc(sizeof(pthread_t) * workers);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->task = NULL;
+    pool->arg = NULL;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stopping = 0;
+
+    // Pool threads start with every signal blocked, leaving signals to the
+    // threads that created the pool
+    sigset_t blocked;
+    sigset_t oldMask;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_BLOCK, &blocked, &oldMask);
+    for (int w = 1; w < workers; w++)
+    {
+        WorkerStart* start = malloc(sizeof(WorkerStart));
+        start->pool = pool;
+        start->worker = w;
+        pthread_create(&pool->threads[w], NULL, workerMain, start);
+    }
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+    return pool;
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Stops and joins every pool thread and frees the pool.
+ * @param pool
+ */
+void workerPoolDelete(WorkerPool* pool)
+{
+    assert(pool != NULL);
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 1; w < pool->workers; w++)
+    {
+        pthread_join(pool->threads[w], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+
+/*** IMPLEMENT ***************************************************************
+ * Runs task on every worker and waits for all of them to finish. The calling
+ * thread runs worker 0's share. Jobs must not be started from inside a task.
+ * @param pool
+ * @param task
+ * @param arg Passed to every call of task.
+ */
+void workerPoolRun(WorkerPool* pool, WorkerTask task, void* arg)
+{
+    assert(pool != NULL && task != NULL);
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->running = pool->workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    task(arg, 0, pool->workers);
+
+    // Wait for the pool threads' shares
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
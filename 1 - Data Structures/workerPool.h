@@ -0,0 +1,43 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+/******************************************************************************
+ * CS 261 Data Structures
+ * Worker Pool
+ * Description: Header file for a fixed set of threads that all run the same
+ *              task on request. The caller takes part as worker 0, and
+ *              workerPoolRun returns once every worker has finished, so a
+ *              job can be split without starting threads each time.
+ *****************************************************************************/
+
+#include <pthread.h>
+
+typedef struct WorkerPool WorkerPool;
+
+// Runs one worker's share of a job. worker is in [0, workers).
+typedef void (*WorkerTask)(void* arg, int worker, int workers);
+
+struct WorkerPool
+{
+    // Number of workers, including the calling thread.
+    int workers;
+    pthread_t* threads;
+    pthread_mutex_t lock;
+    // Signalled when a job starts and when the last worker finishes it.
+    pthread_cond_t start;
+    pthread_cond_t done;
+    // Job being run.
+    WorkerTask task;
+    void* arg;
+    // Incremented for every job, so workers know a new one has started.
+    long generation;
+    // Pool threads still running the current job.
+    int running;
+    int stopping;
+};
+
+WorkerPool* workerPoolNew(int workers);
+void workerPoolDelete(WorkerPool* pool);
+void workerPoolRun(WorkerPool* pool, WorkerTask task, void* arg);
+
+#endif
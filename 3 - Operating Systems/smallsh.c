@@ -7,40 +7,66 @@
 
 // SOURCE: https://brennan.io/2015/01/16/write-a-shell-in-c/
 
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #define INPUT_BUFF_SIZE 2048
 #define ARG_BUFF_SIZE 512
+#define PATH_TABLE_SIZE 64
 
-// Global variable for signal handler
+extern char** environ;
+
+// Global variables for signal handlers
 int foregroundMode = 0;
+volatile sig_atomic_t foregroundGroup = 0;
+
+// Struct for a command's cached location on PATH
+struct pathEntry{
+    char* name;
+    char* path;
+    int hits;
+    struct pathEntry* next;
+};
 
 // Struct for shell variables
 struct shell{
     int argCount;
+    int stageCount;
     int childCount;
+    int childCapacity;
     int shellStatus;
     int exitStatus;
     int background;
     int foreground;
     int redirectIn;
     int redirectOut;
+    int spawn;
+    int terminal;
     int* childProc;
+    int* stages;
     char* inFile;
     char* outFile;
+    struct pathEntry** pathTable;
+    char* pathValue;
 };
 
 /********************************************************************
  * Add child process number to child process array
  *******************************************************************/
 void addChildProc(int childPID, struct shell* vars){
+    if(vars->childCount == vars->childCapacity){
+        vars->childCapacity *= 2;
+        vars->childProc = realloc(vars->childProc, vars->childCapacity * sizeof(int));
+    }
     vars->childProc[vars->childCount++] = childPID;
 }
 
@@ -52,7 +78,7 @@ void removeChildProc(int childPID, struct shell* vars){
     int found = 0;
     int index = 0;
     while(!found && index < vars->childCount){
-        if(vars->childProc[i] == childPID){
+        if(vars->childProc[index] == childPID){
             found = 1;
         }
         else{
@@ -79,19 +105,137 @@ void killChildProc(struct shell* vars){
     free(vars->childProc);
 }
 
+/********************************************************************
+ * Hash a command name into the path table
+ *******************************************************************/
+unsigned int hashCommand(char* name){
+    unsigned int hash = 5381;
+    while(*name != '\0'){
+        hash = hash * 33 + (unsigned char)*name++;
+    }
+    return hash % PATH_TABLE_SIZE;
+}
+
+/********************************************************************
+ * Forget every cached command path
+ *******************************************************************/
+void clearPathTable(struct shell* vars){
+    int i;
+    struct pathEntry* entry;
+    for(i = 0; i < PATH_TABLE_SIZE; i++){
+        while(vars->pathTable[i] != NULL){
+            entry = vars->pathTable[i];
+            vars->pathTable[i] = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+        }
+    }
+}
+
+/********************************************************************
+ * Forget the cached path of one command
+ *******************************************************************/
+void removePathEntry(char* name, struct shell* vars){
+    struct pathEntry** link = &vars->pathTable[hashCommand(name)];
+    while(*link != NULL){
+        if(strcmp((*link)->name, name) == 0){
+            struct pathEntry* entry = *link;
+            *link = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+/********************************************************************
+ * Find the absolute path of a command on PATH, searching the PATH
+ * directories only the first time the command is run and caching the
+ * result. A cached path that is no longer executable is searched for
+ * again, and the cache starts over whenever PATH changes. Returns NULL
+ * when the command should be left to execvp: names with a slash,
+ * commands not found, and searches that reach a relative directory,
+ * whose results would depend on the working directory.
+ *******************************************************************/
+char* findCommand(char* name, struct shell* vars){
+    char* path = getenv("PATH");
+    struct pathEntry* entry;
+    struct stat info;
+
+    if(strchr(name, '/') != NULL || path == NULL){
+        return NULL;
+    }
+
+    // Start over when PATH has changed
+    if(vars->pathValue == NULL || strcmp(vars->pathValue, path) != 0){
+        clearPathTable(vars);
+        free(vars->pathValue);
+        vars->pathValue = strdup(path);
+    }
+
+    // Use the cached path if the command has been found before and is
+    // still there, or forget it and search again
+    unsigned int bucket = hashCommand(name);
+    for(entry = vars->pathTable[bucket]; entry != NULL; entry = entry->next){
+        if(strcmp(entry->name, name) == 0){
+            if(access(entry->path, X_OK) == 0){
+                entry->hits++;
+                return entry->path;
+            }
+            removePathEntry(name, vars);
+            break;
+        }
+    }
+
+    // Otherwise search each PATH directory in order, like execvp
+    size_t nameLength = strlen(name);
+    char* dir = path;
+    while(1){
+        char* end = strchr(dir, ':');
+        size_t dirLength = end != NULL ? (size_t)(end - dir) : strlen(dir);
+        if(dirLength == 0 || dir[0] != '/'){
+            return NULL;
+        }
+
+        char* candidate = malloc(dirLength + nameLength + 2);
+        memcpy(candidate, dir, dirLength);
+        candidate[dirLength] = '/';
+        memcpy(candidate + dirLength + 1, name, nameLength + 1);
+        if(stat(candidate, &info) == 0 && S_ISREG(info.st_mode) && access(candidate, X_OK) == 0){
+            entry = malloc(sizeof(struct pathEntry));
+            entry->name = strdup(name);
+            entry->path = candidate;
+            entry->hits = 1;
+            entry->next = vars->pathTable[bucket];
+            vars->pathTable[bucket] = entry;
+            return candidate;
+        }
+        free(candidate);
+
+        if(end == NULL){
+            return NULL;
+        }
+        dir = end + 1;
+    }
+}
+
 /********************************************************************
  * Frees allocated memory and resets shell vars
  *******************************************************************/
 void cleanUp(char* buffer, char** args, struct shell* vars){
     
     int i;
-    for(i = 0; i < vars->argCount; i++){
+    for(i = 0; args != NULL && i < vars->argCount; i++){
         args[i] = NULL;
     }    
     free(args);
     free(buffer);
     
     vars->argCount = 0;
+    vars->stageCount = 0;
     vars->background = 0;
     vars->redirectIn = 0;
     vars->redirectOut = 0;
@@ -100,9 +244,9 @@ void cleanUp(char* buffer, char** args, struct shell* vars){
 }
 
 /********************************************************************
- * Handle SIGSTP Signal to toggle foregroundMode
+ * Toggle foregroundMode and display message
  *******************************************************************/
-void catchSIGTSTP(int signo){
+void toggleForegroundMode(){
     if(foregroundMode){
         printf("\nExiting foreground-only mode\n");
         write(STDOUT_FILENO, ": ", 2);
@@ -115,6 +259,22 @@ void catchSIGTSTP(int signo){
     }
 }
 
+/********************************************************************
+ * Handle SIGSTP Signal to toggle foregroundMode
+ *******************************************************************/
+void catchSIGTSTP(int signo){
+    toggleForegroundMode();
+}
+
+/********************************************************************
+ * Handle SIGINT Signal by passing it on to the foreground job
+ *******************************************************************/
+void catchSIGINT(int signo){
+    if(foregroundGroup > 0){
+        kill(-foregroundGroup, SIGINT);
+    }
+}
+
 /********************************************************************
  * Checks for terminated background processes and display message
  *******************************************************************/
@@ -159,7 +319,8 @@ int isArgument(char* arg){
  * Returns true if built in function, otherwise false
  *******************************************************************/
 int isBuiltIn(char* arg){
-    if(strcmp(arg, "cd") == 0 || strcmp(arg, "status") == 0 || strcmp(arg, "exit") == 0){
+    if(strcmp(arg, "cd") == 0 || strcmp(arg, "status") == 0 || strcmp(arg, "exit") == 0 ||
+       strcmp(arg, "hash") == 0){
         return 1;
     }
     else{
@@ -203,6 +364,32 @@ void getStatus(struct shell* vars){
     }
 }
 
+/********************************************************************
+ * List the cached command paths, or clear them with hash -r
+ *******************************************************************/
+void hashCommands(char** args, struct shell* vars){
+    int i;
+    int empty = 1;
+    struct pathEntry* entry;
+
+    if(args[1] != NULL && strcmp(args[1], "-r") == 0){
+        clearPathTable(vars);
+        return;
+    }
+    for(i = 0; i < PATH_TABLE_SIZE; i++){
+        for(entry = vars->pathTable[i]; entry != NULL; entry = entry->next){
+            if(empty){
+                printf("hits\tcommand\n");
+                empty = 0;
+            }
+            printf("%4d\t%s\n", entry->hits, entry->path);
+        }
+    }
+    if(empty){
+        printf("hash: hash table empty\n");
+    }
+}
+
 /********************************************************************
  * Executes built in functions and returns status
  *******************************************************************/
@@ -216,6 +403,9 @@ void builtInFx(char** args, struct shell* vars){
     else if(strcmp(args[0], "exit") == 0){
         exitShell(vars);
     }
+    else if(strcmp(args[0], "hash") == 0){
+        hashCommands(args, vars);
+    }
 }
 
 /********************************************************************
@@ -311,60 +501,346 @@ void background(char** args, struct shell* vars){
 }
 
 /********************************************************************
- * Execute command line input via child process
+ * Open a file a spawned stage is redirected to, printing the same
+ * error a forked child would
  *******************************************************************/
-void execute(char** args, struct shell* vars, struct sigaction sigintAction){
+int openStageFile(char* path, int input){
+    int fd;
+    if(input){
+        fd = open(path, O_RDONLY);
+    }
+    else{
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if(fd == -1){
+        printf("cannot open %s for %s\n", path, input ? "input" : "output");
+    }
+    return fd;
+}
+
+/********************************************************************
+ * Launch one pipeline stage with posix_spawn instead of fork, so the
+ * shell's memory is never copied. The redirection foreground() and
+ * background() do in a forked child is opened here in the shell and
+ * handed to the stage as file actions. inFD and outFD are pipe ends
+ * to read from and write to, or -1, and closeFD is a pipe end the
+ * stage must not keep, or -1. command is the stage's cached path, or
+ * NULL to search PATH. Returns the stage's pid, or -1.
+ *******************************************************************/
+pid_t spawnStage(char** stage, char* command, struct shell* vars, int inFD, int outFD,
+                 int closeFD, pid_t group, int runBackground){
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    struct sigaction ignoreAction = {0};
+    struct sigaction oldAction;
+    sigset_t defaults;
+    int srcFD = -1;
+    int targetFD = -1;
+    pid_t cpid = -1;
+    int result;
+
+    // Redirect input to file, or to /dev/null in the background
+    if(inFD == -1 && vars->redirectIn == 1){
+        srcFD = openStageFile(vars->inFile, 1);
+        if(srcFD == -1){
+            return -1;
+        }
+    }
+    else if(inFD == -1 && runBackground){
+        srcFD = openStageFile("/dev/null", 1);
+        if(srcFD == -1){
+            return -1;
+        }
+    }
+    // Redirect output to file, or to /dev/null in the background
+    if(outFD == -1 && vars->redirectOut == 1){
+        targetFD = openStageFile(vars->outFile, 0);
+    }
+    else if(outFD == -1 && runBackground){
+        targetFD = openStageFile("/dev/null", 0);
+    }
+    if(targetFD == -1 && outFD == -1 && (vars->redirectOut == 1 || runBackground)){
+        if(srcFD != -1){
+            close(srcFD);
+        }
+        return -1;
+    }
+    if(srcFD != -1){
+        inFD = srcFD;
+    }
+    if(targetFD != -1){
+        outFD = targetFD;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    if(inFD != -1){
+        posix_spawn_file_actions_adddup2(&actions, inFD, STDIN_FILENO);
+        posix_spawn_file_actions_addclose(&actions, inFD);
+    }
+    if(outFD != -1){
+        posix_spawn_file_actions_adddup2(&actions, outFD, STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, outFD);
+    }
+    if(closeFD != -1){
+        posix_spawn_file_actions_addclose(&actions, closeFD);
+    }
+
+    // Join the job's group, or start it, with the default SIGINT in
+    // the foreground and the default SIGTTOU the shell ignores
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setpgroup(&attr, group);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGTTOU);
+    if(!runBackground){
+        sigaddset(&defaults, SIGINT);
+    }
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+
+    // A background stage inherits SIGINT ignored, as there is no way
+    // to ask posix_spawn for it
+    if(runBackground){
+        ignoreAction.sa_handler = SIG_IGN;
+        sigaction(SIGINT, &ignoreAction, &oldAction);
+    }
+    result = ENOENT;
+    if(command != NULL){
+        result = posix_spawn(&cpid, command, &actions, &attr, stage, environ);
+    }
+    // Search PATH again if the cached path has gone
+    if(result == ENOENT){
+        if(command != NULL){
+            removePathEntry(stage[0], vars);
+        }
+        result = posix_spawnp(&cpid, stage[0], &actions, &attr, stage, environ);
+    }
+    if(runBackground){
+        sigaction(SIGINT, &oldAction, NULL);
+    }
+    if(result != 0){
+        errno = result;
+        perror(stage[0]);
+        cpid = -1;
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if(srcFD != -1){
+        close(srcFD);
+    }
+    if(targetFD != -1){
+        close(targetFD);
+    }
+    return cpid;
+}
+
+/********************************************************************
+ * Wait for every process of a foreground job and keep the status of
+ * its last stage. The shell does not see SIGTSTP while the job has
+ * the terminal, so a job stopped by it toggles foregroundMode and is
+ * continued.
+ *******************************************************************/
+void waitJob(pid_t group, pid_t lastPID, int count, struct shell* vars){
     int childStatus;
     pid_t wpid;
-    pid_t cpid = fork();
 
-    if(cpid < 0){
-        perror("smallsh");
+    // Pass SIGINT on to the job while it runs
+    foregroundGroup = group;
+    while(count > 0){
+        wpid = waitpid(-group, &childStatus, WUNTRACED);
+        if(wpid == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+
+        // A stopped stage has not finished
+        if(WIFSTOPPED(childStatus)){
+            // Continuing the job clears the stop of its other stages,
+            // so each SIGTSTP toggles once
+            if(WSTOPSIG(childStatus) == SIGTSTP){
+                toggleForegroundMode();
+                kill(-group, SIGCONT);
+            }
+            // The job read or set the terminal before it was handed
+            // the terminal, or when there is none to hand it
+            else if(WSTOPSIG(childStatus) == SIGTTIN || WSTOPSIG(childStatus) == SIGTTOU){
+                if(vars->terminal == -1){
+                    kill(-group, SIGTERM);
+                }
+                kill(-group, SIGCONT);
+            }
+            continue;
+        }
+
+        if(wpid == lastPID){
+            vars->exitStatus = childStatus;
+        }
+        count--;
     }
-    // Child process...
-    else if(cpid == 0) {
-        
-        // Foreground-only mode is on
-        if(foregroundMode == 1){
-            sigintAction.sa_handler = SIG_DFL;
-            sigaction(SIGINT, &sigintAction, NULL);
-            
-            foreground(args, vars);
+    foregroundGroup = 0;
+
+    // Take the terminal back from the job
+    if(vars->terminal != -1){
+        tcsetpgrp(vars->terminal, getpgrp());
+    }
+
+    if(WIFSIGNALED(vars->exitStatus)){
+        printf("terminated by signal %d\n", WTERMSIG(vars->exitStatus));
+    }
+}
+
+/********************************************************************
+ * Execute command line input via child processes, one per pipeline
+ * stage. Every stage runs at the same time in one process group,
+ * reading the output of the stage before it through a pipe.
+ *******************************************************************/
+void execute(char** args, struct shell* vars, struct sigaction sigintAction){
+    int runBackground = foregroundMode == 0 && vars->background == 1;
+    int pipeFDs[2];
+    int prevFD = -1;
+    int started = 0;
+    pid_t group = 0;
+    pid_t lastPID = -1;
+    int i;
+
+    for(i = 0; i < vars->stageCount; i++){
+        char** stage = args + vars->stages[i];
+        int last = i == vars->stageCount - 1;
+
+        // Connect this stage's output to the next stage's input
+        if(!last && pipe(pipeFDs) == -1){
+            perror("smallsh");
+            break;
         }
-        // Child process executes in background
-        else if(vars->background == 1){
-            background(args, vars);
+
+        char* command = findCommand(stage[0], vars);
+        pid_t cpid;
+        if(vars->spawn){
+            cpid = spawnStage(stage, command, vars, i > 0 ? prevFD : -1,
+                              last ? -1 : pipeFDs[1], last ? -1 : pipeFDs[0], group,
+                              runBackground);
         }
-        // Child process executes in foreground
         else{
+            cpid = fork();
+        }
+        if(cpid < 0 && !vars->spawn){
+            perror("smallsh");
+            if(!last){
+                close(pipeFDs[0]);
+                close(pipeFDs[1]);
+            }
+            break;
+        }
+        // Child process...
+        else if(cpid == 0) {
+            setpgid(0, group);
+
+            // Only the first stage reads the input file and only the
+            // last stage writes the output file
+            if(i > 0){
+                vars->redirectIn = 0;
+            }
+            if(!last){
+                vars->redirectOut = 0;
+            }
+
+            // Child process executes in background
+            if(runBackground){
+                sigintAction.sa_handler = SIG_IGN;
+                sigaction(SIGINT, &sigintAction, NULL);
+
+                background(stage, vars);
+            }
+            // Child process executes in foreground
+            else{
+                sigintAction.sa_handler = SIG_DFL;
+                sigaction(SIGINT, &sigintAction, NULL);
+
+                // Take the terminal without waiting for the parent
+                if(vars->terminal != -1){
+                    tcsetpgrp(vars->terminal, getpgrp());
+                }
+                
+                foreground(stage, vars);
+            }
             sigintAction.sa_handler = SIG_DFL;
-            sigaction(SIGINT, &sigintAction, NULL);
+            sigaction(SIGTTOU, &sigintAction, NULL);
+
+            // Read from the previous stage and write to the next
+            if(prevFD != -1){
+                dup2(prevFD, STDIN_FILENO);
+                close(prevFD);
+            }
+            if(!last){
+                dup2(pipeFDs[1], STDOUT_FILENO);
+                close(pipeFDs[0]);
+                close(pipeFDs[1]);
+            }
             
-            foreground(args, vars);           
+            // Execute the command line arguments, from its cached path
+            // unless that fails
+            if(command != NULL){
+                execv(command, stage);
+            }
+            if(execvp(stage[0], stage) == -1) {
+                perror(stage[0]);
+                exit(EXIT_FAILURE);
+            }
+            exit(EXIT_SUCCESS);
         }
-        
-        // Execute the command line arguments
-        if(execvp(args[0], args) == -1) {
-            perror(args[0]);
-            exit(EXIT_FAILURE);
+
+        // Parent process joins the child to the job's group too, so
+        // the group exists whichever of them runs first
+        if(cpid > 0){
+            if(group == 0){
+                group = cpid;
+            }
+            setpgid(cpid, group);
+
+            // Hand the terminal to a foreground job while it runs
+            if(started == 0 && !runBackground && vars->terminal != -1){
+                tcsetpgrp(vars->terminal, group);
+            }
+            started++;
+            if(last){
+                lastPID = cpid;
+            }
+            if(runBackground){
+                addChildProc(cpid, vars);
+            }
         }
-        exit(EXIT_SUCCESS);
-    }
-    // Parent process...
-    else{
-        if(foregroundMode == 0 && vars->background == 1){
-            addChildProc(cpid, vars);
-            printf("background pid is %d\n", cpid);
+        // A stage that could not be spawned fails like a child that
+        // could not exec, with its error already printed and no
+        // process to reap, in the background too
+        else if(last){
+            vars->exitStatus = EXIT_FAILURE << 8;
         }
-        else{
-            wpid = waitpid(cpid, &childStatus, WUNTRACED);
-            vars->exitStatus = childStatus;
- 
-            if(WIFSIGNALED(vars->exitStatus)){
-                printf("terminated by signal %d\n", WTERMSIG(vars->exitStatus));
-            }
+
+        // Only the next stage keeps the read end of the pipe
+        if(prevFD != -1){
+            close(prevFD);
+            prevFD = -1;
+        }
+        if(!last){
+            close(pipeFDs[1]);
+            prevFD = pipeFDs[0];
         }
     }
+    if(prevFD != -1){
+        close(prevFD);
+    }
+
+    if(started == 0){
+        return;
+    }
+    if(runBackground){
+        printf("background pid is %d\n", group);
+    }
+    else{
+        waitJob(group, lastPID, started, vars);
+    }
 }
 
 /********************************************************************
@@ -375,9 +851,14 @@ char** getArgs(char* buffer, struct shell* vars){
     char** args = malloc(ARG_BUFF_SIZE * sizeof(char*));
 
     if(buffer == NULL){
+        free(args);
         return NULL;
     }
 
+    // The first pipeline stage starts at the first argument
+    vars->stages[0] = 0;
+    vars->stageCount = 1;
+
     // Loop until all arguments are gathered
     token = strtok(buffer, " \n\r\t\a");
     while(token != NULL){
@@ -403,22 +884,46 @@ char** getArgs(char* buffer, struct shell* vars){
                 vars->outFile = token;
             }
         }
+        else if(strcmp(token, "|") == 0){
+            // End the stage's arguments and start the next stage
+            if(vars->argCount == vars->stages[vars->stageCount - 1]){
+                printf("smallsh: missing command in pipeline\n");
+                free(args);
+                return NULL;
+            }
+            args[vars->argCount++] = NULL;
+            vars->stages[vars->stageCount++] = vars->argCount;
+        }
         else{
             args[vars->argCount++] = token;
         }
 
-        if(vars->argCount > ARG_BUFF_SIZE){
+        if(vars->argCount >= ARG_BUFF_SIZE - 1){
             printf("smallsh: number of arguments exceeded buffer\n");
             return NULL;
         }
         token = strtok(NULL, " \n\r\t\a");
     }
 
+    args[vars->argCount] = NULL;
+
+    // Every stage after a | needs a command
+    if(vars->stageCount > 1 && vars->argCount == vars->stages[vars->stageCount - 1]){
+        printf("smallsh: missing command in pipeline\n");
+        free(args);
+        return NULL;
+    }
+
     // Check for &, the background process argument
     if(vars->argCount > 1 && strcmp(args[vars->argCount - 1], "&") == 0){
         vars->background = 1;
         args[vars->argCount - 1] = NULL;
     }
+    if(args[vars->stages[vars->stageCount - 1]] == NULL && vars->stageCount > 1){
+        printf("smallsh: missing command in pipeline\n");
+        free(args);
+        return NULL;
+    }
     return args;
 }
 
@@ -451,9 +956,10 @@ char* getCmdLine(){
 
 /********************************************************************
  * Initialize shell buffers, signal handlers, and status vars. Run 
- * loop for shell.
+ * loop for shell. Usage: smallsh [-s], where -s launches commands
+ * with posix_spawn instead of fork.
  *******************************************************************/
-int main(){
+int main(int argc, char** argv){
     // Flush buffers
     fflush(stdin);
     fflush(stdout);
@@ -461,13 +967,15 @@ int main(){
     // Create buffers and initialize shell vars
     char* buffer;
     char** args;
+    int i;
     struct shell* vars = malloc(sizeof(struct shell));
    
-    // Set to ignore SIGINT
+    // Set to send SIGINT to handler, which passes it on to the
+    // foreground job in its own process group
     struct sigaction sigintAction = {0};
-    sigintAction.sa_handler = SIG_IGN;
+    sigintAction.sa_handler = catchSIGINT;
     sigfillset(&sigintAction.sa_mask);
-    sigintAction.sa_flags = 0;
+    sigintAction.sa_flags = SA_RESTART;
     sigaction(SIGINT, &sigintAction, NULL);
 
     // Set to send SIGSTP to handler
@@ -477,15 +985,35 @@ int main(){
     sigtstpAction.sa_flags = SA_RESTART;
     sigaction(SIGTSTP, &sigtstpAction, NULL);
 
+    // Find the terminal to hand to foreground jobs, if the shell is
+    // in its foreground, and ignore SIGTTOU to take it back after
+    vars->terminal = -1;
+    for(i = STDIN_FILENO; i <= STDERR_FILENO && vars->terminal == -1; i++){
+        if(isatty(i) && tcgetpgrp(i) == getpgrp()){
+            vars->terminal = i;
+        }
+    }
+    if(vars->terminal != -1){
+        struct sigaction sigttouAction = {0};
+        sigttouAction.sa_handler = SIG_IGN;
+        sigaction(SIGTTOU, &sigttouAction, NULL);
+    }
+
     // Initialize shell variables
     vars->argCount = 0;
+    vars->stageCount = 0;
     vars->childCount = 0;
+    vars->childCapacity = 20;
     vars->shellStatus = 1;
     vars->exitStatus = 0;
     vars->background = 0;
     vars->redirectIn = 0;
     vars->redirectOut = 0;
-    vars->childProc = malloc(20 * sizeof(int));
+    vars->spawn = argc > 1 && strcmp(argv[1], "-s") == 0;
+    vars->childProc = malloc(vars->childCapacity * sizeof(int));
+    vars->stages = malloc(ARG_BUFF_SIZE * sizeof(int));
+    vars->pathTable = calloc(PATH_TABLE_SIZE, sizeof(struct pathEntry*));
+    vars->pathValue = NULL;
     vars->inFile = NULL;
     vars->outFile = NULL;
     
@@ -497,8 +1025,13 @@ int main(){
         buffer = getCmdLine();
         args = getArgs(buffer, vars);
 
-        if(isArgument(args[0])){
-            if(isBuiltIn(args[0])){
+        // Exit at the end of a script instead of prompting forever
+        if(buffer == NULL && feof(stdin)){
+            exitShell(vars);
+        }
+        else if(args != NULL && isArgument(args[0])){
+            // Built in functions run in the shell unless piped
+            if(vars->stageCount == 1 && isBuiltIn(args[0])){
                 builtInFx(args, vars);
             }
             else{
@@ -508,6 +1041,10 @@ int main(){
         cleanUp(buffer, args, vars);
         checkBackground(vars);
     }
+    clearPathTable(vars);
+    free(vars->pathTable);
+    free(vars->pathValue);
+    free(vars->stages);
     free(vars);
     return EXIT_SUCCESS;
 }
\ No newline at end of file